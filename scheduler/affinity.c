@@ -0,0 +1,62 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Show or set the CPUs a process may run on, or run a command
+// on a set of CPUs:
+//   affinity pid
+//   affinity pid mask
+//   affinity -e mask command [args...]
+// Masks have bit i set for cpu i, in decimal or 0x hex.
+
+uint
+parsemask(char *s)
+{
+  uint m = 0;
+  int d;
+
+  if(s[0] == '0' && s[1] == 'x'){
+    for(s += 2; *s; s++){
+      if(*s >= '0' && *s <= '9')
+        d = *s - '0';
+      else if(*s >= 'a' && *s <= 'f')
+        d = *s - 'a' + 10;
+      else
+        return 0;
+      m = m*16 + d;
+    }
+    return m;
+  }
+  return atoi(s);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid, mask;
+
+  if(argc >= 4 && strcmp(argv[1], "-e") == 0){
+    if(sched_setaffinity(getpid(), parsemask(argv[2])) < 0){
+      printf(2, "affinity: bad mask %s\n", argv[2]);
+      exit();
+    }
+    exec(argv[3], argv + 3);
+    printf(2, "affinity: exec %s failed\n", argv[3]);
+    exit();
+  }
+  if(argc < 2 || argc > 3 || argv[1][0] == '-'){
+    printf(2, "usage: affinity pid [mask] | affinity -e mask command [args...]\n");
+    exit();
+  }
+  pid = atoi(argv[1]);
+  if(argc == 3 && sched_setaffinity(pid, parsemask(argv[2])) < 0){
+    printf(2, "affinity: cannot set pid %d to %s\n", pid, argv[2]);
+    exit();
+  }
+  if((mask = sched_getaffinity(pid)) < 0){
+    printf(2, "affinity: no process %d\n", pid);
+    exit();
+  }
+  printf(1, "%d: 0x%x\n", pid, mask);
+  exit();
+}
@@ -0,0 +1,17 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Give best-effort processes budget ticks out of every period
+// while EDF tasks run; budget 0 turns the reservation off.
+int
+main(int argc, char **argv)
+{
+  if(argc != 3){
+    printf(2, "usage: cbs budget period\n");
+    exit();
+  }
+  if(sched_server(atoi(argv[1]), atoi(argv[2])) < 0)
+    printf(2, "cbs: cannot reserve %s/%s\n", argv[1], argv[2]);
+  exit();
+}
@@ -0,0 +1,84 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "sched.h"
+
+// TC#6: RMS priority inheritance through a sleep lock.  Expects
+// one CPU (make CPUS=1).
+// L (low priority) writes a file and sleeps on the disk holding
+// its inode lock.  H (high) then wants the same inode and blocks
+// behind L, while M (medium) only spins.  L inherits H's
+// priority, so H finishes before M, and M before L.  Without
+// inheritance M would run ahead of L, and so of H.
+
+char buf[512];
+
+int
+child(int go, int fd, int writer)
+{
+    struct stat st;
+    char c;
+    int i;
+
+    int cid = fork();
+    if(cid != 0)
+        return cid;
+    read(go, &c, 1);
+    if(writer){
+        for(i = 0; i < 64; i++)
+            write(fd, buf, sizeof(buf));
+    } else if(fd >= 0){
+        fstat(fd, &st);
+    }
+    /*The XV6 kills the process if th exec time is completed*/
+    while(1) {
+
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct sched_attr a[3];
+    int pids[3], go[3][2];
+    int i, fd;
+
+    fd = open("inherit.tmp", O_CREATE | O_RDWR);
+    if(fd < 0){
+        printf(1, "assig2_6: cannot create inherit.tmp\n");
+        exit();
+    }
+    for(i = 0; i < 3; i++)
+        pipe(go[i]);
+
+    // H, M and L are pids 4, 5 and 6.
+    pids[0] = child(go[0][0], fd, 0);
+    pids[1] = child(go[1][0], -1, 0);
+    pids[2] = child(go[2][0], fd, 1);
+
+    memset(a, 0, sizeof(a));
+    for(i = 0; i < 3; i++)
+        a[i].policy = SCHED_RMS;
+    // Rates 25, 15 and 1 are on RMS levels 1, 2 and 3.
+    a[0].exec_time = 1;
+    a[0].rate = 25;
+    a[1].exec_time = 2;
+    a[1].rate = 15;
+    a[2].exec_time = 20;
+    a[2].rate = 1;
+    if(sched_setattrs(pids, a, 3) != 3)
+        printf(1, "assig2_6: not admitted\n");
+
+    // Start L, then H and M once L is waiting on the disk: this
+    // process only runs again when L sleeps.
+    write(go[2][1], "x", 1);
+    sleep(1);
+    write(go[0][1], "x", 1);
+    write(go[1][1], "x", 1);
+
+    for(i = 0; i < 3; i++)
+        wait();
+    close(fd);
+    unlink("inherit.tmp");
+    exit();
+}
@@ -0,0 +1,75 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "sched.h"
+
+// TC#7: sched_setattr() and the old parameter calls reject bad
+// parameters and leave the task as it was.
+
+void
+check(char *what, int got, int want)
+{
+    if(got == want)
+        printf(1, "assig2_7: %s: ok\n", what);
+    else
+        printf(1, "assig2_7: %s: got %d, want %d\n", what, got, want);
+}
+
+int
+setattr(int pid, int policy, int exec, int deadline, int rate, int tickets)
+{
+    struct sched_attr a;
+
+    a.policy = policy;
+    a.exec_time = exec;
+    a.deadline = deadline;
+    a.rate = rate;
+    a.tickets = tickets;
+    return sched_setattr(pid, &a);
+}
+
+int main(int argc, char *argv[])
+{
+    struct sched_attr a[2];
+    int pids[2];
+
+    int cid = fork();
+    if(cid == 0){
+        while(1)
+            sleep(100);
+    }
+
+    check("edf zero exec", setattr(cid, SCHED_EDF, 0, 10, 0, 0), -22);
+    check("edf zero deadline", setattr(cid, SCHED_EDF, 5, 0, 0, 0), -22);
+    check("edf exec past deadline", setattr(cid, SCHED_EDF, 10, 5, 0, 0), -22);
+    check("rms zero rate", setattr(cid, SCHED_RMS, 5, 0, 0, 0), -22);
+    check("rms rate 31", setattr(cid, SCHED_RMS, 1, 0, 31, 0), -22);
+    check("rms exec past period", setattr(cid, SCHED_RMS, 50, 0, 3, 0), -22);
+    check("stride zero tickets", setattr(cid, SCHED_STRIDE, 0, 0, 0, 0), -22);
+    check("unknown policy", setattr(cid, 7, 5, 10, 1, 1), -22);
+    check("unknown pid", setattr(9999, SCHED_STRIDE, 0, 0, 0, 10), -22);
+    check("stride", setattr(cid, SCHED_STRIDE, 0, 0, 0, 10), 0);
+
+    // The batch form stops at the first bad entry.
+    memset(a, 0, sizeof(a));
+    pids[0] = pids[1] = cid;
+    a[0].policy = SCHED_STRIDE;
+    a[0].tickets = 20;
+    a[1].policy = SCHED_EDF;
+    a[1].exec_time = 10;
+    a[1].deadline = 5;
+    check("setattrs stops at bad entry", sched_setattrs(pids, a, 2), 1);
+
+    // An admitted task keeps its parameters consistent.
+    check("edf", setattr(cid, SCHED_EDF, 10, 100, 0, 0), 0);
+    check("deadline zero", deadline(cid, 0), -22);
+    check("deadline below exec_time", deadline(cid, 4), -22);
+    check("exec_time past deadline", exec_time(cid, 200), -22);
+    check("deadline", deadline(cid, 50), 0);
+    check("rate zero", rate(cid, 0), -22);
+    check("rate 31", rate(cid, 31), -22);
+
+    kill(cid);
+    wait();
+    exit();
+}
@@ -0,0 +1,36 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// TC#8: CPU affinity.  Expects one CPU (make CPUS=1).
+
+void
+check(char *what, int got, int want)
+{
+    if(got == want)
+        printf(1, "assig2_8: %s: ok\n", what);
+    else
+        printf(1, "assig2_8: %s: got %d, want %d\n", what, got, want);
+}
+
+int main(int argc, char *argv[])
+{
+    int pid = getpid();
+
+    check("default mask", sched_getaffinity(pid), 1);
+    check("empty mask", sched_setaffinity(pid, 0), -22);
+    check("missing cpus only", sched_setaffinity(pid, 0x80000000), -22);
+    check("missing cpus dropped", sched_setaffinity(pid, 0x80000001), 0);
+    check("mask after set", sched_getaffinity(pid), 1);
+    check("unknown pid set", sched_setaffinity(9999, 1), -22);
+    check("unknown pid get", sched_getaffinity(9999), -22);
+
+    int cid = fork();
+    if(cid == 0){
+        check("child inherits mask", sched_getaffinity(getpid()), 1);
+        exit();
+    }
+    wait();
+    check("reaped child", sched_setaffinity(cid, 1), -22);
+    exit();
+}
@@ -24,7 +24,7 @@ fi
 echo "Setting the test directory"
 
 tar -xzvf "$submission" -C ./test_dir
-cp check_schedulability.py assig2_*.c *.sh ./test_dir
+cp check_schedulability.py assig2_*.c out_assig2_* *.sh ./test_dir
 cd ./test_dir
 
 FILE=*[Rr][Ee][Pp][Oo][Rr][Tt]*.pdf
@@ -82,8 +82,20 @@ echo "Running..5"
 adduprogs _assig2_5
 timeout 30s ./test_assig2.sh assig2_5|grep -i 'the completed process'|sed 's/$ //g' > res_assig2_5
 
+echo "Running..6"
+adduprogs _assig2_6
+timeout 30s ./test_assig2.sh assig2_6|grep -i 'the completed process'|sed 's/$ //g' > res_assig2_6
 
-check_test=5
+echo "Running..7"
+adduprogs _assig2_7
+timeout 30s ./test_assig2.sh assig2_7|grep 'assig2_7:'|tr -d '\r' > res_assig2_7
+
+echo "Running..8"
+adduprogs _assig2_8
+timeout 30s ./test_assig2.sh assig2_8|grep 'assig2_8:'|tr -d '\r' > res_assig2_8
+
+
+check_test=8
 total_test=0
 
 echo "" > .output
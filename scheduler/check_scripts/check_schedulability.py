@@ -9,9 +9,12 @@ EDF_data = {
 RM_data = {
     '2': ['4', '5', '3'],
     '5': ['3', '4', '5', '7'],
+    '6': ['4', '5', '6'],
 }
 
-RMS_tid = ['2', '5']
+RMS_tid = ['2', '5', '6']
+# Compared line by line with out_assig2_<id>.
+DIFF_tid = ['7', '8']
 EDF_tid = ['1', '3', '4']
 
 test_id = sys.argv[1]
@@ -21,7 +24,13 @@ result = {
     'arrival_time': [],
     'absolute_deadline': []
 }
-if(test_id in RMS_tid):
+if(test_id in DIFF_tid):
+    with open(f"res_assig2_{test_id}") as my_file, open(f"out_assig2_{test_id}") as want:
+        if [l.strip() for l in my_file] != [l.strip() for l in want]:
+            print("FAIL")
+            exit(1)
+
+elif(test_id in RMS_tid):
     with open(f"res_assig2_{test_id}") as my_file:
         lines = my_file.readlines()
         for line in lines:
@@ -0,0 +1,36 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "sched.h"
+
+// Print how busy each CPU was over an interval, default one
+// second.  Cycle counts are scaled down by 1024 so that the
+// arithmetic fits in 32 bits.
+int
+main(int argc, char **argv)
+{
+  struct cpustat s0[NCPU], s1[NCPU];
+  uint idle, total;
+  int i, n, t;
+
+  t = 100;
+  if(argc > 1)
+    t = atoi(argv[1]);
+  n = cpustat(s0, NCPU);
+  sleep(t);
+  if(cpustat(s1, n) != n){
+    printf(2, "cpuload: cpustat failed\n");
+    exit();
+  }
+  for(i = 0; i < n; i++){
+    idle = (s1[i].idle - s0[i].idle) >> 10;
+    total = (s1[i].tsc - s0[i].tsc) >> 10;
+    total = total/100 + 1;
+    idle /= total;
+    if(idle > 100)
+      idle = 100;
+    printf(1, "cpu%d: %d%% busy\n", i, 100 - idle);
+  }
+  exit();
+}
@@ -2,9 +2,14 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct ktimer;
 struct pipe;
 struct proc;
 struct rtcdate;
+struct sched_attr;
+struct schedevent;
+struct schedstats;
+struct cpustat;
 struct spinlock;
 struct sleeplock;
 struct stat;
@@ -53,6 +58,15 @@ int             readi(struct inode*, char*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
 
+// fpu.c
+void            fpuexec(void);
+void            fpufork(struct proc*);
+void            fpuinit(void);
+void            fpuinit1(void);
+void            fpusave(struct proc*);
+void            fpuswitch(struct proc*);
+void            fputrap(void);
+
 // ide.c
 void            ideinit(void);
 void            ideintr(void);
@@ -78,7 +92,11 @@ int             lapicid(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
+void            lapicipi(int, int);
 void            lapicstartap(uchar, uint);
+void            lapictimer(uint);
+uint            lapictimercount(void);
+void            lapictimermode(int);
 void            microdelay(int);
 
 // log.c
@@ -117,15 +135,36 @@ void            sched(void);
 void            setproc(struct proc*);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
+void            jobdone(void);
+void            lockowner(struct sleeplock*, struct proc*);
+void            lockwait(struct sleeplock*);
+void            jobcomplete(struct proc*);
+void            deadlinetick(void);
+void            budgettimer(struct proc*);
+void            cputime(struct proc*, int);
+int             overbudget(struct proc*);
+void            cbstick(void);
+void            mlfqtick(void);
+int             needresched(void);
+void            gangtick(void);
+int             set_server(int, int);
+int             set_tickets(int, int);
+int             getcpustat(struct cpustat*, int);
+int             getstats(int, struct schedstats*);
 int             wait(void);
 void            wakeup(void*);
 void            yield(void);
 int             set_exec_time(int, int);
 int             set_rate(int, int);
 int             set_deadline(int, int);
-int             set_sched_policy(int, int);
+int             set_sched_policy(int, int, int);
 int             is_edf_schedulable(int);
-int             is_rms_schedulable(int);
+int             is_rms_schedulable(int, int);
+int             sched_setattr(int, struct sched_attr*);
+int             sched_setattrs(int*, struct sched_attr*, int);
+int             set_affinity(int, uint);
+int             get_affinity(int);
+int             set_gang(int, int);
 
 
 
@@ -165,7 +204,25 @@ int             fetchstr(uint, char**);
 void            syscall(void);
 
 // timer.c
+uint64          nsec(void);
+uint64          ticks2cycles(uint);
+int             sleepuntil(uint);
+void            timeradd(struct ktimer*, uint, void(*)(void*), void*);
+void            timeralarm(uint64);
+int             timerdel(struct ktimer*);
+void            timerbusy(void);
 void            timerinit(void);
+int             timerintr(void);
+
+// trace.c
+void            traceinit(void);
+void            tracelog(int, int, int);
+int             traceread(struct schedevent*, int);
+#ifdef SCHEDTRACE
+#define TRACE(type, pid, arg) tracelog(type, pid, arg)
+#else
+#define TRACE(type, pid, arg) do { } while(0)
+#endif
 
 // trap.c
 void            idtinit(void);
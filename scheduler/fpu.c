@@ -0,0 +1,138 @@
+// x87 and SSE state, switched lazily.
+// Each process has its own FPU state, saved with FXSAVE in
+// p->fpu.  The scheduler sets CR0.TS when it switches to a
+// process, so the process's first FPU or SSE instruction traps
+// with #NM (T_DEVICE) and fputrap() loads its state.  Processes
+// that never use the FPU never pay for it.
+//
+// While a process runs, CR0.TS clear means the registers hold
+// its current state, and CR0.TS set means p->fpu does.  A CPU
+// remembers whose state it loaded last (fpuowner); if that
+// process comes back to the same CPU, the registers are still
+// its own and TS is cleared without a reload.  The kernel itself
+// never uses the FPU.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+
+#define CPUID_FXSR  (1 << 24)   // cpuid 1, %edx: FXSAVE/FXRSTOR
+#define CPUID_SSE   (1 << 25)   // and SSE
+#define MXCSR_INIT  0x1F80      // all SSE exceptions masked
+
+// State a process starts with, after FNINIT.
+static uchar fpuinitstate[512] __attribute__((aligned(16)));
+
+static void
+stts(void)
+{
+  lcr0(rcr0() | CR0_TS);
+}
+
+// Enable the FPU and SSE on this CPU and reset its registers.
+static void
+fpusetup(void)
+{
+  uint a, b, c, d;
+
+  rdcpuid(1, &a, &b, &c, &d);
+  if(!(d & CPUID_FXSR))
+    panic("fpuinit: no FXSAVE");
+  lcr0((rcr0() & ~CR0_EM) | CR0_MP | CR0_NE);
+  if(d & CPUID_SSE)
+    lcr4(rcr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+  fninit();
+  if(d & CPUID_SSE)
+    ldmxcsr(MXCSR_INIT);
+}
+
+// Boot CPU, before the others start: save the clean state
+// every process starts with.
+void
+fpuinit1(void)
+{
+  fpusetup();
+  fxsave(fpuinitstate);
+  stts();
+}
+
+// Every CPU: enable the FPU, with CR0.TS set.
+void
+fpuinit(void)
+{
+  fpusetup();
+  mycpu()->fpuowner = 0;
+  stts();
+}
+
+// The scheduler is about to run p on this CPU.
+void
+fpuswitch(struct proc *p)
+{
+  struct cpu *c = mycpu();
+
+  if(c->fpuowner == p && p->fpucpu == c - cpus)
+    clts();
+  else if(!(rcr0() & CR0_TS))
+    stts();
+}
+
+// p has stopped running on this CPU.  If it used the FPU, save
+// the state; the registers keep it too, in case p comes back.
+void
+fpusave(struct proc *p)
+{
+  if(rcr0() & CR0_TS)
+    return;
+  if(p->state != ZOMBIE)
+    fxsave(p->fpu);
+  stts();
+}
+
+// #NM: the current process used the FPU with CR0.TS set.  The
+// previous owner's state was saved when it was switched out.
+void
+fputrap(void)
+{
+  struct proc *p = myproc();
+  struct cpu *c = mycpu();
+
+  clts();
+  fxrstor(p->fpuused ? p->fpu : fpuinitstate);
+  p->fpuused = 1;
+  p->fpucpu = c - cpus;
+  c->fpuowner = p;
+}
+
+// Give the child np a copy of the current process's FPU state.
+void
+fpufork(struct proc *np)
+{
+  struct proc *curproc = myproc();
+
+  pushcli();
+  if(!(rcr0() & CR0_TS))
+    fxsave(curproc->fpu);
+  popcli();
+  np->fpuused = curproc->fpuused;
+  if(np->fpuused)
+    memmove(np->fpu, curproc->fpu, sizeof(np->fpu));
+}
+
+// exec: the current process starts over with a clean FPU.
+// Forget the registers on every CPU that holds its state.
+void
+fpuexec(void)
+{
+  struct proc *curproc = myproc();
+
+  pushcli();
+  if(!(rcr0() & CR0_TS))
+    stts();
+  popcli();
+  curproc->fpuused = 0;
+  curproc->fpucpu = -1;
+}
@@ -0,0 +1,37 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Put a process in a gang-scheduled process group, or run a
+// command in one; its children join the group too:
+//   gang pid group
+//   gang -e group command [args...]
+// Group 0 is no group.
+
+int
+main(int argc, char *argv[])
+{
+  int pid, g;
+
+  if(argc >= 4 && strcmp(argv[1], "-e") == 0){
+    g = atoi(argv[2]);
+    if(sched_gang(getpid(), g) < 0){
+      printf(2, "gang: bad group %s\n", argv[2]);
+      exit();
+    }
+    exec(argv[3], argv + 3);
+    printf(2, "gang: exec %s failed\n", argv[3]);
+    exit();
+  }
+  if(argc != 3 || argv[1][0] == '-'){
+    printf(2, "usage: gang pid group | gang -e group command [args...]\n");
+    exit();
+  }
+  pid = atoi(argv[1]);
+  g = atoi(argv[2]);
+  if(sched_gang(pid, g) < 0){
+    printf(2, "gang: cannot put pid %d in group %d\n", pid, g);
+    exit();
+  }
+  exit();
+}
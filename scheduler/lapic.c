@@ -32,6 +32,7 @@
 #define TIMER   (0x0320/4)   // Local Vector Table 0 (TIMER)
   #define X1         0x0000000B   // divide counts by 1
   #define PERIODIC   0x00020000   // Periodic
+  #define ONESHOT    0x00000000   // One-shot
 #define PCINT   (0x0340/4)   // Performance Counter LVT
 #define LINT0   (0x0350/4)   // Local Vector Table 1 (LINT0)
 #define LINT1   (0x0360/4)   // Local Vector Table 2 (LINT1)
@@ -42,6 +43,7 @@
 #define TDCR    (0x03E0/4)   // Timer Divide Configuration
 
 volatile uint *lapic;  // Initialized in mp.c
+static int oneshot;    // Timer is one-shot; see timer.c
 
 //PAGEBREAK!
 static void
@@ -60,13 +62,12 @@ lapicinit(void)
   // Enable local APIC; set spurious interrupt vector.
   lapicw(SVR, ENABLE | (T_IRQ0 + IRQ_SPURIOUS));
 
-  // The timer repeatedly counts down at bus frequency
-  // from lapic[TICR] and then issues an interrupt.
-  // If xv6 cared more about precise timekeeping,
-  // TICR would be calibrated using an external time source.
+  // The timer counts down at bus frequency from lapic[TICR]
+  // and then issues an interrupt.  Until timer.c has calibrated
+  // it, it repeats; after that it is one-shot and timer.c
+  // programs it for each event.
   lapicw(TDCR, X1);
-  lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-  lapicw(TICR, 10000000);
+  lapictimermode(oneshot);
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -113,6 +114,51 @@ lapiceoi(void)
     lapicw(EOI, 0);
 }
 
+// Send interrupt vector to the CPU with the given APIC ID.
+void
+lapicipi(int apicid, int vector)
+{
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+
+// Select one-shot or periodic timer mode.  A periodic
+// timer starts right away; a one-shot one is idle until
+// lapictimer() arms it.
+void
+lapictimermode(int os)
+{
+  if(!lapic)
+    return;
+  oneshot = os;
+  if(oneshot){
+    lapicw(TIMER, ONESHOT | (T_IRQ0 + IRQ_TIMER));
+    lapicw(TICR, 0);
+  } else {
+    lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
+    lapicw(TICR, 10000000);
+  }
+}
+
+// Arm the one-shot timer to fire after count bus cycles;
+// 0 disarms it.
+void
+lapictimer(uint count)
+{
+  if(lapic)
+    lapicw(TICR, count);
+}
+
+uint
+lapictimercount(void)
+{
+  if(!lapic)
+    return 0;
+  return lapic[TCCR];
+}
+
 // Spin for a given number of microseconds.
 // On real hardware would want to tune this dynamically.
 void
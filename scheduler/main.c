@@ -31,6 +31,9 @@ main(void)
   binit();         // buffer cache
   fileinit();      // file table
   ideinit();       // disk 
+  timerinit();     // calibrate clock, one-shot APIC timer
+  traceinit();     // scheduler event trace
+  fpuinit1();      // clean FPU state for new processes
   startothers();   // start other processors
   kinit2(P2V(4*1024*1024), P2V(PHYSTOP)); // must come after startothers()
   userinit();      // first user process
@@ -53,6 +56,7 @@ mpmain(void)
 {
   cprintf("cpu%d: starting %d\n", cpuid(), cpuid());
   idtinit();       // load idt register
+  fpuinit();       // x87 and SSE, switched lazily
   xchg(&(mycpu()->started), 1); // tell startothers() we're up
   scheduler();     // start running processes
 }
@@ -6,10 +6,16 @@
 
 // Control Register flags
 #define CR0_PE          0x00000001      // Protection Enable
+#define CR0_MP          0x00000002      // Monitor coProcessor
+#define CR0_EM          0x00000004      // Emulation
+#define CR0_TS          0x00000008      // Task Switched
+#define CR0_NE          0x00000020      // Numeric Error
 #define CR0_WP          0x00010000      // Write Protect
 #define CR0_PG          0x80000000      // Paging
 
 #define CR4_PSE         0x00000010      // Page size extension
+#define CR4_OSFXSR      0x00000200      // FXSAVE/FXRSTOR and SSE enabled
+#define CR4_OSXMMEXCPT  0x00000400      // SSE exceptions raise #XM
 
 // various segment selectors.
 #define SEG_KCODE 1  // kernel code
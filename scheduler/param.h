@@ -1,5 +1,9 @@
+#ifndef NPROC
 #define NPROC        64  // maximum number of processes
+#endif
 #define KSTACKSIZE 4096  // size of per-process kernel stack
+#define NPIDHASH     64  // pid hash buckets, a power of 2
+#define NCHANHASH    64  // sleep channel hash buckets, a power of 2
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
@@ -11,4 +15,16 @@
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       1000  // size of file system in blocks
+#define NRMSPRIO        4  // RMS static priority levels
+#define MAXRTTICKS (1<<17)  // longest EDF deadline or execution time
+#define MAXSERVER  (1<<15)  // longest best-effort server period
+#define HZ            100  // timer ticks per second
+#define WORSTFIT        1  // place real-time tasks on the least loaded CPU
+#define NMLFQ           3  // feedback queue levels for default processes
+#define QUANTUM         1  // ticks at the top level, doubling per level
+#define BOOSTTICKS    100  // move everything to the top level this often
+#define GANGSLICE      10  // ticks each process group has the CPUs for
+#define NTICKETS      100  // default stride tickets
+#define NTRACE        512  // trace events per CPU, a power of 2
+#define STRIDE1   (1<<20)  // stride of a process with one ticket
 
@@ -0,0 +1,1153 @@
+// Scheduling policies: the run-queue structures, the choice of
+// the next process, and admission of EDF and RMS tasks.  Nothing
+// here touches the hardware, so schedsim.c can build it on the
+// host and drive it tick by tick.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sched.h"
+#include "runq.h"
+
+struct runq runqs[NCPU];
+int cbsbudget;                 // CBS reservation, 0 if off;
+int cbsperiod;                 // set under ptable.lock
+
+// Number of best-effort processes waiting on rq.
+int
+nbest(struct runq *rq)
+{
+  return rq->nready - rq->nedf - rq->nrms;
+}
+
+// A process holding a sleep lock is queued at least as
+// urgently as the processes waiting for it: EDF waiters lend it
+// their deadline, RMS waiters their priority.  These give the
+// policy and keys it is queued with.
+int
+qpolicy(struct proc *p)
+{
+  if(p->sched_policy == SCHED_EDF || p->ipolicy == SCHED_EDF)
+    return SCHED_EDF;
+  if(p->sched_policy == SCHED_RMS || p->ipolicy == SCHED_RMS)
+    return SCHED_RMS;
+  return p->sched_policy;
+}
+
+int
+edfkey(struct proc *p)
+{
+  int d = p->arrival_time + p->deadline;
+
+  if(p->ipolicy == SCHED_EDF && (p->sched_policy != SCHED_EDF || p->ideadline < d))
+    d = p->ideadline;
+  return d;
+}
+
+int
+rmskey(struct proc *p)
+{
+  int prio = p->sched_policy == SCHED_RMS ? p->rmsprio : NRMSPRIO;
+
+  if(p->ipolicy == SCHED_RMS && p->iprio < prio)
+    prio = p->iprio;
+  return prio;
+}
+
+static int
+edfless(struct proc *a, struct proc *b)
+{
+  int da = edfkey(a);
+  int db = edfkey(b);
+
+  return da < db || (da == db && a->pid < b->pid);
+}
+
+// Stride processes are ordered by pass, compared so that the
+// values may wrap.
+static int
+strideless(struct proc *a, struct proc *b)
+{
+  int d = a->pass - b->pass;
+
+  return d < 0 || (d == 0 && a->pid < b->pid);
+}
+
+// Binary min-heaps of processes, used for the EDF and stride
+// queues.  p->heapidx is p's slot in the heap it is on.
+
+static void
+heapset(struct proc **h, int i, struct proc *p)
+{
+  h[i] = p;
+  p->heapidx = i;
+}
+
+static void
+heapup(struct proc **h, int i, int (*less)(struct proc*, struct proc*))
+{
+  struct proc *p = h[i];
+
+  while(i > 0 && less(p, h[(i-1)/2])){
+    heapset(h, i, h[(i-1)/2]);
+    i = (i-1)/2;
+  }
+  heapset(h, i, p);
+}
+
+static void
+heapdown(struct proc **h, int n, int i, int (*less)(struct proc*, struct proc*))
+{
+  struct proc *p = h[i];
+  int c;
+
+  while((c = 2*i+1) < n){
+    if(c+1 < n && less(h[c+1], h[c]))
+      c++;
+    if(!less(h[c], p))
+      break;
+    heapset(h, i, h[c]);
+    i = c;
+  }
+  heapset(h, i, p);
+}
+
+static void
+heappush(struct proc **h, int *n, struct proc *p, int (*less)(struct proc*, struct proc*))
+{
+  if(p->heapidx >= 0)
+    panic("heappush");
+  heapset(h, (*n)++, p);
+  heapup(h, p->heapidx, less);
+}
+
+static void
+heapremove(struct proc **h, int *n, struct proc *p, int (*less)(struct proc*, struct proc*))
+{
+  int i = p->heapidx;
+  struct proc *last;
+
+  if(i < 0 || h[i] != p)
+    panic("heapremove");
+  p->heapidx = -1;
+  last = h[--*n];
+  if(last == p)
+    return;
+  heapset(h, i, last);
+  heapup(h, i, less);
+  heapdown(h, *n, last->heapidx, less);
+}
+
+// RMS static priority, computed once when the rate or policy
+// is set: the weight ceil(3*(30-rate)/29), at least 1.  Lower
+// weights run first.
+int
+rmsprio(int rate)
+{
+  int w = (3*(30-rate) + 28) / 29;
+
+  if(w < 1)
+    w = 1;
+  if(w > NRMSPRIO)
+    w = NRMSPRIO;
+  return w;
+}
+
+// Doubly-linked FIFO lists, used for the RMS priority levels,
+// the MLFQ levels and the gang list.
+static void
+listadd(struct proc **head, struct proc **tail, struct proc *p, int front)
+{
+  if(front){
+    p->rqprev = 0;
+    p->rqnext = *head;
+    if(*head)
+      (*head)->rqprev = p;
+    else
+      *tail = p;
+    *head = p;
+  } else {
+    p->rqnext = 0;
+    p->rqprev = *tail;
+    if(*tail)
+      (*tail)->rqnext = p;
+    else
+      *head = p;
+    *tail = p;
+  }
+}
+
+static void
+listremove(struct proc **head, struct proc **tail, struct proc *p)
+{
+  if(p->rqprev)
+    p->rqprev->rqnext = p->rqnext;
+  else
+    *head = p->rqnext;
+  if(p->rqnext)
+    p->rqnext->rqprev = p->rqprev;
+  else
+    *tail = p->rqprev;
+}
+
+static void
+rmsadd(struct runq *rq, struct proc *p, int front)
+{
+  int i = rmskey(p) - 1;
+
+  listadd(&rq->rmshead[i], &rq->rmstail[i], p, front);
+  rq->rmsmap |= 1 << i;
+  rq->nrms++;
+}
+
+static void
+rmsremove(struct runq *rq, struct proc *p)
+{
+  int i = rmskey(p) - 1;
+
+  listremove(&rq->rmshead[i], &rq->rmstail[i], p);
+  if(rq->rmshead[i] == 0)
+    rq->rmsmap &= ~(1 << i);
+  rq->nrms--;
+}
+
+// Full quantum of MLFQ level l, in ticks.
+int
+mlfqquantum(int l)
+{
+  return QUANTUM << l;
+}
+
+// A preempted process that still has quantum left goes back to
+// the front of its level and keeps the CPU; one that used it up
+// was demoted and goes to the back.
+static void
+mlfqadd(struct runq *rq, struct proc *p, int front)
+{
+  int l = p->mlfqlevel;
+
+  front = front && p->quantum < mlfqquantum(l);
+  listadd(&rq->mlfqhead[l], &rq->mlfqtail[l], p, front);
+  rq->mlfqmap |= 1 << l;
+}
+
+static void
+mlfqremove(struct runq *rq, struct proc *p)
+{
+  int l = p->mlfqlevel;
+
+  listremove(&rq->mlfqhead[l], &rq->mlfqtail[l], p);
+  if(rq->mlfqhead[l] == 0)
+    rq->mlfqmap &= ~(1 << l);
+}
+
+// The server becomes busy.  Keep its deadline if the budget
+// left can be used by then without exceeding the reserved
+// bandwidth, else start a new period with a full budget.
+static void
+cbswake(struct runq *rq)
+{
+  int left = rq->cbsdeadline - (int)ticks;
+
+  if(left <= 0 || rq->cbsleft*cbsperiod >= left*cbsbudget){
+    rq->cbsleft = cbsbudget;
+    rq->cbsdeadline = ticks + cbsperiod;
+  }
+}
+
+// Count best-effort p, n = 1 or -1, for each CPU it may run on.
+static void
+stealcount(struct runq *rq, struct proc *p, int n)
+{
+  uint m;
+
+  if(SCHED_RT(qpolicy(p)))
+    return;
+  for(m = p->affinity & ((1u << NCPU) - 1); m; m &= m - 1)
+    rq->nsteal[__builtin_ctz(m)] += n;
+}
+
+// runqadd() is called right after a process becomes RUNNABLE,
+// runqdel() right before it stops being RUNNABLE or before its
+// policy, deadline, priority or CPU changes.  A preempted process
+// goes back to the front of its RMS priority level, so equal
+// priority tasks run in FIFO order rather than taking turns.
+// An admitted real-time task always goes on its own CPU's queue.
+// Caller holds ptable.lock.
+void
+runqadd(struct runq *rq, struct proc *p, int front)
+{
+  if(p->rq)
+    panic("runqadd");
+  if(p->rtcpu >= 0)
+    rq = &runqs[p->rtcpu];
+  else if(!CANRUN(p, rq - runqs))
+    rq = &runqs[__builtin_ctz(p->affinity)];
+  if(qpolicy(p) != SCHED_EDF && qpolicy(p) != SCHED_RMS &&
+     nbest(rq) == 0 && cbsbudget)
+    cbswake(rq);
+  if(qpolicy(p) == SCHED_EDF)
+    heappush(rq->edf, &rq->nedf, p, edfless);
+  else if(qpolicy(p) == SCHED_RMS)
+    rmsadd(rq, p, front);
+  else if(GANGED(p))
+    listadd(&rq->ganghead, &rq->gangtail, p, 0);
+  else if(qpolicy(p) == SCHED_STRIDE){
+    // A process that slept gets no credit for it.
+    if((int)(p->pass - rq->vtime) < 0)
+      p->pass = rq->vtime;
+    heappush(rq->stride, &rq->nstride, p, strideless);
+  } else
+    mlfqadd(rq, p, front);
+  rq->nready++;
+  stealcount(rq, p, 1);
+  p->rq = rq;
+  kick(rq, p);
+}
+
+// Returns the queue p was on, so callers can put it back.
+struct runq*
+runqdel(struct proc *p)
+{
+  struct runq *rq = p->rq;
+
+  if(rq == 0)
+    panic("runqdel");
+  if(qpolicy(p) == SCHED_EDF)
+    heapremove(rq->edf, &rq->nedf, p, edfless);
+  else if(qpolicy(p) == SCHED_RMS)
+    rmsremove(rq, p);
+  else if(GANGED(p))
+    listremove(&rq->ganghead, &rq->gangtail, p);
+  else if(qpolicy(p) == SCHED_STRIDE)
+    heapremove(rq->stride, &rq->nstride, p, strideless);
+  else
+    mlfqremove(rq, p);
+  rq->nready--;
+  stealcount(rq, p, -1);
+  p->rq = 0;
+  return rq;
+}
+
+// Default processes: the head of the highest non-empty MLFQ
+// level, so each level is served round robin.
+struct proc* choose_round_robin(struct runq *rq)
+{
+  if(rq->mlfqmap == 0)
+    return 0;
+  return rq->mlfqhead[__builtin_ctz(rq->mlfqmap)];
+}
+
+// The earliest-deadline RUNNABLE EDF process is the heap root.
+struct proc* choose_edf_process(struct runq *rq)
+{
+  if(rq->nedf == 0)
+    return 0;
+  return rq->edf[0];
+}
+
+// The most urgent RMS priority level is the lowest set bit
+// of rmsmap; run the process at the head of that level.
+struct proc* choose_rm_process(struct runq *rq)
+{
+  if(rq->rmsmap == 0)
+    return 0;
+  return rq->rmshead[__builtin_ctz(rq->rmsmap)];
+}
+
+// A member of the group being gang-scheduled, else the stride
+// process with the lowest pass, else a default one, else a
+// member of another group.  Group members take turns.
+struct proc*
+choose_best_effort(struct runq *rq)
+{
+  struct proc *p;
+
+  if(ptable.gang)
+    for(p = rq->ganghead; p; p = p->rqnext)
+      if(p->gang == ptable.gang)
+        return p;
+  if(rq->nstride > 0)
+    return rq->stride[0];
+  if(rq->mlfqmap)
+    return choose_round_robin(rq);
+  return rq->ganghead;
+}
+
+// Pick the next process from rq: EDF tasks first, then RMS,
+// then stride, then everything else round robin.  The server competes with
+// the EDF tasks on its deadline and wins ties to none.  Time
+// the best-effort processes spent running in the background
+// is not charged, so a deadline left behind by it is renewed.
+struct proc*
+choose(struct runq *rq)
+{
+  struct proc *p;
+
+  if(rq->nedf > 0){
+    p = choose_edf_process(rq);
+    if(cbsbudget && nbest(rq) && rq->cbsdeadline <= (int)ticks)
+      cbswake(rq);
+    if(cbsbudget && nbest(rq) &&
+       rq->cbsdeadline < edfkey(p)){
+      p = choose_best_effort(rq);
+      mycpu()->server = rq;
+    }
+  } else if(rq->nrms > 0)
+    p = choose_rm_process(rq);
+  else
+    p = choose_best_effort(rq);
+  return p;
+}
+
+// Should p, just queued, take the CPU from q, which is running
+// there?  Real-time processes preempt the processes choose()
+// would put after them, and members of the group being
+// gang-scheduled preempt other best-effort processes; anything
+// else waits for the next tick.
+int
+preempts(struct proc *p, struct proc *q)
+{
+  int pp = qpolicy(p), qp = qpolicy(q);
+
+  if(pp == SCHED_EDF)
+    return qp != SCHED_EDF || edfkey(p) < edfkey(q);
+  if(pp == SCHED_RMS)
+    return qp != SCHED_EDF && (qp != SCHED_RMS || rmskey(p) < rmskey(q));
+  if(SCHED_RT(qp))
+    return 0;
+  return p->gang && p->gang == ptable.gang && q->gang != ptable.gang;
+}
+
+// Find a peer queue for an idle cpu to take work from, without
+// locks; the caller re-checks with stealable().  Real-time tasks
+// stay on the CPU admission gave them, so only best-effort
+// processes are stolen, from the busiest peer holding one that
+// may run on cpu.
+struct runq*
+stealfrom(int cpu)
+{
+  struct runq *q, *best = 0;
+
+  if(runqs[cpu].nready > 0)
+    return 0;
+  for(q = runqs; q < &runqs[ncpu]; q++)
+    if(q != &runqs[cpu] && q->nsteal[cpu] > 0 &&
+       (best == 0 || nbest(best) < nbest(q)))
+      best = q;
+  return best;
+}
+
+// The best-effort process on rq for cpu to take: the one
+// choose() would run if it may run there, else any that may.
+struct proc*
+stealable(struct runq *rq, int cpu)
+{
+  struct proc *p;
+  int i;
+
+  p = choose_best_effort(rq);
+  if(p && !CANRUN(p, cpu)){
+    for(p = rq->ganghead; p && !CANRUN(p, cpu); p = p->rqnext)
+      ;
+    for(i = 0; p == 0 && i < rq->nstride; i++)
+      if(CANRUN(rq->stride[i], cpu))
+        p = rq->stride[i];
+    for(i = 0; p == 0 && i < NMLFQ; i++)
+      for(p = rq->mlfqhead[i]; p && !CANRUN(p, cpu); p = p->rqnext)
+        ;
+  }
+  return p;
+}
+
+// Partitioned admission.  Each admitted EDF or RMS task is
+// assigned a CPU, p->rtcpu, and is only ever queued there, so
+// the uniprocessor tests are run per CPU.  On one CPU the EDF
+// tasks run ahead of the RMS tasks: the EDF test bounds the
+// utilisation of that CPU's EDF tasks and server, and the RMS
+// response-time test counts the EDF tasks as interference.
+// A new task goes to the least loaded CPU that passes, or the
+// first one without WORSTFIT; if none does, all real-time tasks
+// are re-packed first-fit in order of decreasing utilisation.
+
+static int
+isedf(struct proc *p)
+{
+  return p->sched_policy==SCHED_EDF &&
+         (p->state==RUNNABLE || p->state==RUNNING || p->state==SLEEPING);
+}
+
+// Can a task with these parameters run under policy?  Every
+// EDF or RMS task is checked before it is admitted or charged,
+// which keeps rtweight() at most UTIL1 and free of overflow.
+int
+rtvalid(int policy, int exec_time, int deadline, int rate)
+{
+  if(exec_time <= 0 || exec_time > MAXRTTICKS)
+    return 0;
+  if(policy == SCHED_EDF)
+    return deadline >= exec_time && deadline <= MAXRTTICKS;
+  if(policy == SCHED_RMS)
+    return rate >= 1 && rate <= 30 && exec_time*rate <= 100;
+  return 0;
+}
+
+// Utilisation of a real-time task, in UTIL1s.
+static int
+rtweight(struct proc *p)
+{
+  if(p->sched_policy == SCHED_EDF)
+    return UTIL1*p->exec_time/p->deadline;
+  return UTIL1/100*p->exec_time*p->rate;
+}
+
+static int
+serverutil(void)
+{
+  return cbsbudget ? UTIL1*cbsbudget/cbsperiod : 0;
+}
+
+// The per-CPU totals in ptable are kept as tasks come and go
+// rather than summed at each admission.  An admitted task is
+// charged to its CPU by commit(), and refunded when it leaves
+// or before its parameters change; p->util is -1 while p is not
+// charged.  Caller holds ptable.lock.
+void
+rtcharge(struct proc *p)
+{
+  if(p->rtcpu < 0 || p->util >= 0)
+    return;
+  p->util = rtweight(p);
+  ptable.urt[p->rtcpu] += p->util;
+  if(p->sched_policy == SCHED_EDF){
+    ptable.uedf[p->rtcpu] += p->util;
+    ptable.nedf[p->rtcpu]++;
+  }
+}
+
+void
+rtrefund(struct proc *p)
+{
+  if(p->util < 0)
+    return;
+  ptable.urt[p->rtcpu] -= p->util;
+  if(p->sched_policy == SCHED_EDF){
+    ptable.uedf[p->rtcpu] -= p->util;
+    ptable.nedf[p->rtcpu]--;
+  }
+  p->util = -1;
+}
+
+// p stops being an admitted real-time task.
+void
+rtleave(struct proc *p)
+{
+  rmsleave(p);
+  rtrefund(p);
+  p->rtcpu = -1;
+}
+
+// Would cpu's EDF tasks and the server, with p added if it is
+// an EDF task, use more than all of it?
+static int
+edfover(struct proc *p, int cpu)
+{
+  int u = ptable.uedf[cpu] + serverutil();
+
+  if(p->sched_policy == SCHED_EDF)
+    u += rtweight(p);
+  return u > UTIL1;
+}
+
+static int rmsresponse(struct proc*, struct proc*, int);
+
+// Reserve budget ticks in every period for best-effort
+// processes on each CPU, or with budget 0 turn the server off.
+// Fails if the EDF tasks already admitted to some CPU leave
+// too little room, or an admitted RMS task would then miss its
+// deadline.  The period is bounded so that the server's
+// arithmetic cannot overflow.
+int
+set_server(int budget, int period)
+{
+  struct runq *rq;
+  int oldbudget, oldperiod, i;
+
+  if(budget < 0 || period <= 0 || budget > period || period > MAXSERVER)
+    return -22;
+  acquire(&ptable.lock);
+  oldbudget = cbsbudget;
+  oldperiod = cbsperiod;
+  cbsbudget = 0;
+  for(i = 0; budget && i < ncpu; i++)
+    if(ptable.uedf[i] + UTIL1*budget/period > UTIL1)
+      goto bad;
+  cbsbudget = budget;
+  cbsperiod = period;
+  for(i = 0; i < ptable.nrms; i++)
+    if(rmsresponse(ptable.rms[i], ptable.rms[i], 0) < 0)
+      goto bad;
+  rmsstale();
+  for(rq = runqs; rq < &runqs[NCPU]; rq++){
+    rq->cbsleft = budget;
+    rq->cbsdeadline = ticks + period;
+  }
+  release(&ptable.lock);
+  return 0;
+
+bad:
+  cbsbudget = oldbudget;
+  cbsperiod = oldperiod;
+  release(&ptable.lock);
+  return -22;
+}
+
+// RMS admission.  ptable.rms holds the admitted RMS tasks sorted
+// by static priority then pid, each with its worst-case response
+// time in p->rmsresp.  A task with rate r has period 100/r ticks,
+// so it meets its deadline if its response time R has R*r <= 100.
+// Equal-priority tasks are counted as interfering with each other.
+
+static int
+rmsbefore(struct proc *a, struct proc *b)
+{
+  return a->rmsprio < b->rmsprio ||
+         (a->rmsprio == b->rmsprio && a->pid < b->pid);
+}
+
+// Remove p from the admitted set, if it is there.
+// Returns 1 if it was.
+int
+rmsleave(struct proc *p)
+{
+  int i;
+
+  for(i = 0; i < ptable.nrms; i++)
+    if(ptable.rms[i] == p)
+      break;
+  if(i == ptable.nrms)
+    return 0;
+  for(ptable.nrms--; i < ptable.nrms; i++)
+    ptable.rms[i] = ptable.rms[i+1];
+  return 1;
+}
+
+void
+rmsinsert(struct proc *p)
+{
+  int i, j;
+
+  for(i = 0; i < ptable.nrms && rmsbefore(ptable.rms[i], p); i++)
+    ;
+  for(j = ptable.nrms++; j > i; j--)
+    ptable.rms[j] = ptable.rms[j-1];
+  ptable.rms[i] = p;
+}
+
+// A task's parameters changed, so cached response times may be
+// larger than the least fixed point; recompute from scratch.
+void
+rmsstale(void)
+{
+  int i;
+
+  for(i = 0; i < ptable.nrms; i++)
+    ptable.rms[i]->rmsresp = 0;
+}
+
+// Jobs of t released during a busy period of length r,
+// times t's execution time.
+static int
+rmsinterference(struct proc *t, int r)
+{
+  return (r*t->rate + 99)/100 * t->exec_time;
+}
+
+// Worst-case response time of p on its CPU, iterating the
+// response-time recurrence R = C + sum ceil(R/T_j)*C_j over the
+// EDF tasks and the admitted RMS tasks at least as urgent as p
+// there, plus the candidate c.  The server runs only against
+// EDF tasks, but while one is queued it may run ahead on budget
+// up to that task's deadline, so with EDF tasks on the CPU it
+// counts for ceil((R + D_max)/T_s)*Q_s.  Starts from r, which must not
+// exceed the answer.  Returns -1 if p misses its deadline.
+static int
+rmsresponse(struct proc *p, struct proc *c, int r)
+{
+  struct proc *t;
+  int i, next, dmax;
+
+  // A task without a rate has no deadline to miss.
+  if(p->rate <= 0)
+    return p->exec_time;
+  if(r < p->exec_time)
+    r = p->exec_time;
+  for(;;){
+    next = p->exec_time;
+    for(i = 0; i < ptable.nrms; i++){
+      t = ptable.rms[i];
+      if(t->rmsprio > p->rmsprio)
+        break;
+      if(t != p && t->rtcpu == p->rtcpu)
+        next += rmsinterference(t, r);
+    }
+    if(c != p && c->sched_policy == SCHED_RMS &&
+       c->rtcpu == p->rtcpu && c->rmsprio <= p->rmsprio)
+      next += rmsinterference(c, r);
+    dmax = 0;
+    for(t = ptable.proc; t < &ptable.proc[NPROC]; t++)
+      if(isedf(t) && t->rtcpu == p->rtcpu){
+        next += (r + t->deadline - 1)/t->deadline * t->exec_time;
+        if(t->deadline > dmax)
+          dmax = t->deadline;
+      }
+    if(cbsbudget && dmax)
+      next += (r + dmax + cbsperiod - 1)/cbsperiod * cbsbudget;
+    if(next*p->rate > 100)
+      return -1;
+    if(next == r)
+      return r;
+    r = next;
+  }
+}
+
+// Does every RMS task on c's CPU, with c, run at its
+// rate-monotonic priority?  rmsprio() folds the rates into a few
+// FIFO levels, so that holds only if tasks sharing a level share
+// a rate; the levels themselves are ordered by rate.
+static int
+rmsdistinct(struct proc *c)
+{
+  int rate[NRMSPRIO+1];
+  struct proc *t;
+  int i;
+
+  memset(rate, 0, sizeof(rate));
+  rate[c->rmsprio] = c->rate;
+  for(i = 0; i < ptable.nrms; i++){
+    t = ptable.rms[i];
+    if(t->rtcpu != c->rtcpu)
+      continue;
+    if(rate[t->rmsprio] && rate[t->rmsprio] != t->rate)
+      return 0;
+    rate[t->rmsprio] = t->rate;
+  }
+  return 1;
+}
+
+// Hyperbolic bound for the RMS tasks on c's CPU:
+// prod(1 + U_i) <= 2, with U_i = C_i*r_i/100, in 16.16 fixed
+// point.  The first factor is rounded down and the others up.
+// Only valid on a CPU without EDF tasks whose RMS tasks pass
+// rmsdistinct().
+static int
+rmsadmit_hb(struct proc *c)
+{
+  struct proc *t;
+  uint prod;
+  int i;
+
+  prod = ((100 + c->exec_time*c->rate) << 16) / 100;
+  for(i = 0; i < ptable.nrms && prod <= (2 << 16); i++){
+    t = ptable.rms[i];
+    if(t->rtcpu == c->rtcpu)
+      prod = (prod*(100 + t->exec_time*t->rate) + 99) / 100;
+  }
+  return prod <= (2 << 16) ? 0 : -1;
+}
+
+// Would cpu stay schedulable with the candidate p on it?
+// Fills resp[i] with the new response time of ptable.rms[i] and
+// resp[ptable.nrms] with p's, for commit().  Only RMS tasks no
+// more urgent than p feel its interference; each of those grows
+// by at least p's execution time, so their iteration restarts
+// from the old response time plus that instead of from scratch.
+// Under the hyperbolic bound response times are left unknown;
+// where it does not apply, SCHED_HB falls back to the exact test.
+static int
+fits(struct proc *p, int cpu, int test, int *resp)
+{
+  struct proc *t;
+  int i, hb, rms;
+
+  p->rtcpu = cpu;
+  rms = p->sched_policy == SCHED_RMS;
+  if(edfover(p, cpu))
+    return 0;
+  hb = rms && test == SCHED_HB && ptable.nedf[cpu] == 0 && rmsdistinct(p);
+  resp[ptable.nrms] = 0;
+  if(hb && rmsadmit_hb(p) < 0)
+    return 0;
+  if(rms && !hb && (resp[ptable.nrms] = rmsresponse(p, p, 0)) < 0)
+    return 0;
+  for(i = 0; i < ptable.nrms; i++){
+    t = ptable.rms[i];
+    resp[i] = t->rmsresp;
+    if(t->rtcpu != cpu || (rms && t->rmsprio < p->rmsprio))
+      continue;
+    if(hb)
+      resp[i] = 0;
+    else if((resp[i] = rmsresponse(t, p, t->rmsresp + p->exec_time)) < 0)
+      return 0;
+  }
+  return 1;
+}
+
+// Keep the response times fits() computed for p, charge p to
+// its CPU and add it to the RMS set.
+static void
+commit(struct proc *p, int *resp)
+{
+  int i;
+
+  rtcharge(p);
+  for(i = 0; i < ptable.nrms; i++)
+    ptable.rms[i]->rmsresp = resp[i];
+  if(p->sched_policy == SCHED_RMS){
+    p->rmsresp = resp[ptable.nrms];
+    rmsinsert(p);
+  }
+}
+
+// Move p to its CPU's queue.
+static void
+rehome(struct proc *p)
+{
+  if(p->state == RUNNABLE && p->rq != &runqs[p->rtcpu])
+    runqadd(runqdel(p), p, 0);
+}
+
+// Try p on each CPU it may run on, least loaded first with
+// WORSTFIT.
+static int
+place(struct proc *p, int test, int *resp)
+{
+  int tried[NCPU], load[NCPU];
+  int i, n, cpu;
+
+  for(i = 0; i < ncpu; i++){
+    tried[i] = !CANRUN(p, i);
+    load[i] = ptable.urt[i];
+  }
+  for(n = 0; n < ncpu; n++){
+    cpu = -1;
+    for(i = 0; i < ncpu; i++)
+      if(!tried[i] && (cpu < 0 || (WORSTFIT && load[i] < load[cpu])))
+        cpu = i;
+    if(cpu < 0)
+      break;
+    tried[cpu] = 1;
+    if(fits(p, cpu, test, resp)){
+      commit(p, resp);
+      rehome(p);
+      return 0;
+    }
+  }
+  p->rtcpu = -1;
+  return -1;
+}
+
+// Scratch space for admission, too big for a kernel stack once
+// NPROC grows.  Guarded by ptable.lock, like the admitted set.
+static struct {
+  struct proc *set[NPROC];   // repack(): the tasks to place
+  struct proc *rms[NPROC];   // and the old RMS set,
+  int cpu[NPROC];            // CPUs
+  int oldresp[NPROC];        // and response times
+  int resp[NPROC+1];         // fits(): the new response times
+} adm;
+
+// First-fit decreasing over every admitted real-time task and
+// the candidate c.  On failure the old assignment is restored.
+static int
+repack(struct proc *c, int test, int *resp)
+{
+  struct proc **set = adm.set, **rms = adm.rms, *p;
+  int *cpu = adm.cpu, *oldresp = adm.oldresp;
+  int i, j, n, nrms;
+
+  n = 0;
+  set[n++] = c;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p != c && isedf(p) && p->rtcpu >= 0)
+      set[n++] = p;
+  for(i = 0; i < ptable.nrms; i++)
+    set[n++] = ptable.rms[i];
+  for(i = 1; i < n; i++){
+    p = set[i];
+    for(j = i; j > 0 && rtweight(set[j-1]) < rtweight(p); j--)
+      set[j] = set[j-1];
+    set[j] = p;
+  }
+
+  nrms = ptable.nrms;
+  for(i = 0; i < nrms; i++)
+    rms[i] = ptable.rms[i];
+  for(i = 0; i < n; i++){
+    cpu[i] = set[i]->rtcpu;
+    oldresp[i] = set[i]->rmsresp;
+    rtrefund(set[i]);
+    set[i]->rtcpu = -1;
+  }
+  ptable.nrms = 0;
+
+  for(i = 0; i < n; i++){
+    for(j = 0; j < ncpu; j++)
+      if(CANRUN(set[i], j) && fits(set[i], j, test, resp))
+        break;
+    if(j == ncpu){
+      for(i = 0; i < n; i++){
+        rtrefund(set[i]);
+        set[i]->rtcpu = cpu[i];
+        set[i]->rmsresp = oldresp[i];
+        rtcharge(set[i]);
+      }
+      ptable.nrms = nrms;
+      for(i = 0; i < nrms; i++)
+        ptable.rms[i] = rms[i];
+      return -1;
+    }
+    commit(set[i], resp);
+  }
+  for(i = 0; i < n; i++)
+    rehome(set[i]);
+  return 0;
+}
+
+// Assign the EDF or RMS task p to a CPU.  Caller holds
+// ptable.lock and has taken p out of the RMS set.
+int
+admit(struct proc *p, int test)
+{
+  if(place(p, test, adm.resp) < 0 && repack(p, test, adm.resp) < 0)
+    return -1;
+  return 0;
+}
+
+// Per-tick and per-job policy.  proc.c calls these for the
+// kernel, taking ptable.lock around them, and schedsim calls
+// them the same way, so the simulator runs this code rather
+// than a copy.  Caller holds ptable.lock.
+
+// Release time of periodic task p's next job, which is also the
+// deadline of its current one.  An EDF task's
+// period is its relative deadline; an RMS task with rate r has
+// period 100/r ticks, so job k is released at 100*k/r ticks
+// after the first, without accumulating rounding error.
+int
+nextrelease(struct proc *p)
+{
+  if(p->sched_policy == SCHED_EDF)
+    return p->arrival_time + p->deadline;
+  if(p->rate <= 0)
+    return p->arrival_time;
+  return p->firstrelease + 100*p->njobs/p->rate;
+}
+
+int
+hasdeadline(struct proc *p)
+{
+  if(p->sched_policy == SCHED_EDF)
+    return p->deadline > 0;
+  return p->sched_policy == SCHED_RMS && p->rate > 0;
+}
+
+// Count a miss the first time p's current job is seen past its
+// deadline.
+void
+misscheck(struct proc *p)
+{
+  int d;
+
+  if(p->missed || !hasdeadline(p))
+    return;
+  d = nextrelease(p);
+  if((int)ticks <= d)
+    return;
+  p->missed = 1;
+  p->nmisses++;
+  ptable.stats.misses++;
+  TRACE(TR_MISS, p->pid, d);
+}
+
+// Visit the EDF heap below slot i, skipping subtrees whose
+// earliest key is not yet due.  A key is never later than its
+// process's own deadline, so no miss is skipped.
+static void
+heapmisses(struct runq *rq, int i)
+{
+  if(i >= rq->nedf || edfkey(rq->edf[i]) >= (int)ticks)
+    return;
+  misscheck(rq->edf[i]);
+  heapmisses(rq, 2*i+1);
+  heapmisses(rq, 2*i+2);
+}
+
+// Count misses of jobs still waiting on rq, so that a job
+// starved past its deadline is seen before it is dispatched.
+// RMS levels are FIFO, so only the head of each is checked.
+void
+queuemisses(struct runq *rq)
+{
+  uint m;
+
+  heapmisses(rq, 0);
+  for(m = rq->rmsmap; m; m &= m - 1)
+    misscheck(rq->rmshead[__builtin_ctz(m)]);
+}
+
+// The current job of real-time task p has used up its budget.
+// Account its response time and lateness.
+void
+jobend(struct proc *p)
+{
+  int resp, late;
+
+  misscheck(p);
+  resp = ticks - p->arrival_time;
+  late = hasdeadline(p) ? ticks - nextrelease(p) : 0;
+  if(late < 0)
+    late = 0;
+  p->jobsdone++;
+  p->totresp += resp;
+  p->totlate += late;
+  if(resp > p->maxresp)
+    p->maxresp = resp;
+  if(late > p->maxlate)
+    p->maxlate = late;
+  ptable.stats.jobs++;
+  ptable.stats.totresp += resp;
+  ptable.stats.totlate += late;
+  if(resp > ptable.stats.maxresp)
+    ptable.stats.maxresp = resp;
+  if(late > ptable.stats.maxlate)
+    ptable.stats.maxlate = late;
+  TRACE(TR_COMPLETE, p->pid, p->arrival_time);
+}
+
+// Start periodic task p's next job with a fresh budget and move
+// its release time, and with it the absolute deadline, forward.
+// Returns the new release time.
+int
+jobnext(struct proc *p)
+{
+  int next = nextrelease(p);
+
+  p->arrival_time = next;
+  TRACE(TR_RELEASE, p->pid, next);
+  p->elapsed_time = 0;
+  p->jobcycles = 0;
+  p->missed = 0;
+  p->njobs++;
+  return next;
+}
+
+// Every BOOSTTICKS, move every default process that is not
+// running back to the top level, so demoted CPU-bound processes
+// cannot starve and ones that have turned interactive are served
+// promptly again.
+void
+mlfqboost(void)
+{
+  struct proc *p;
+  struct runq *rq;
+
+  if(ticks - ptable.lastboost < BOOSTTICKS)
+    return;
+  ptable.lastboost = ticks;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->sched_policy != SCHED_DEFAULT || p->mlfqlevel == 0 ||
+       p->state == RUNNING)
+      continue;
+    rq = 0;
+    if(p->state == RUNNABLE)
+      rq = runqdel(p);
+    p->mlfqlevel = 0;
+    p->quantum = mlfqquantum(0);
+    if(rq)
+      runqadd(rq, p, 0);
+  }
+}
+
+// A tick of running process p.  Charge its quantum and demote it
+// a level when the quantum is used up.  Only p's CPU touches a
+// running process's level, so this needs no lock.
+void
+mlfqcharge(struct proc *p)
+{
+  if(p->sched_policy != SCHED_DEFAULT || --p->quantum > 0)
+    return;
+  if(p->mlfqlevel < NMLFQ-1)
+    p->mlfqlevel++;
+  p->quantum = mlfqquantum(p->mlfqlevel);
+}
+
+// A tick of the process rq's server chose was used up.  An
+// exhausted server is refilled at once with its deadline a
+// period later, so it yields to EDF tasks due before that.
+void
+cbscharge(struct runq *rq)
+{
+  if(--rq->cbsleft <= 0){
+    rq->cbsleft = cbsbudget;
+    rq->cbsdeadline += cbsperiod;
+  }
+}
+
+// Every GANGSLICE ticks the next process group in order of id
+// gets its slot, then the ungrouped processes get one if any are
+// runnable.  The group's RUNNABLE members are spread over CPUs
+// not already running one of them, and kick() preempts what
+// those CPUs run, so the whole group is dispatched at once.
+void
+gangrotate(void)
+{
+  struct proc *p;
+  struct cpu *c;
+  struct runq *rq;
+  uint busy;
+  int first, next, others, i;
+
+  if(ticks - ptable.gangstart < GANGSLICE)
+    return;
+  ptable.gangstart = ticks;
+  first = next = others = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if((p->state != RUNNABLE && p->state != RUNNING) ||
+       SCHED_RT(qpolicy(p)))
+      continue;
+    if(p->gang == 0)
+      others = 1;
+    else {
+      if(first == 0 || p->gang < first)
+        first = p->gang;
+      if(p->gang > ptable.gang && (next == 0 || p->gang < next))
+        next = p->gang;
+    }
+  }
+  if(ptable.gang == 0 || (next == 0 && !others))
+    next = first;
+  ptable.gang = next;
+  if(next == 0)
+    return;
+
+  busy = 0;
+  for(c = cpus; c < &cpus[ncpu]; c++)
+    if(c->proc && c->proc->gang == next)
+      busy |= 1 << (c - cpus);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->gang != next || p->state != RUNNABLE || !GANGED(p))
+      continue;
+    for(i = 0; i < ncpu && ((busy >> i & 1) || !CANRUN(p, i)); i++)
+      ;
+    rq = runqdel(p);
+    if(i < ncpu){
+      rq = &runqs[i];
+      busy |= 1 << i;
+    }
+    runqadd(rq, p, 0);
+  }
+}
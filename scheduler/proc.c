@@ -6,11 +6,13 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "sleeplock.h"
+#include "traps.h"
+#include "sched.h"
+#include "runq.h"
+
+struct ptable ptable;
 
-struct {
-  struct spinlock lock;
-  struct proc proc[NPROC];
-} ptable;
 
 static struct proc *initproc;
 
@@ -19,11 +21,55 @@ extern void forkret(void);
 extern void trapret(void);
 
 static void wakeup1(void *chan);
+static struct runq *myrunq(void);
+static void inherit(struct proc *p);
 
 void
 pinit(void)
 {
+  int i;
+
   initlock(&ptable.lock, "ptable");
+  for(i = NPROC-1; i >= 0; i--){
+    ptable.proc[i].pidnext = ptable.free;
+    ptable.free = &ptable.proc[i];
+  }
+}
+
+// Live processes are found through a hash on pid, and slots
+// are allocated from a free list, so neither scans the table.
+// Both are under ptable.lock.
+static struct proc**
+pidbucket(int pid)
+{
+  return &ptable.pidhash[pid & (NPIDHASH-1)];
+}
+
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  for(p = *pidbucket(pid); p; p = p->pidnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+// Unhash p and return its slot to the free list.
+static void
+procfree(struct proc *p)
+{
+  struct proc **pp;
+
+  for(pp = pidbucket(p->pid); *pp; pp = &(*pp)->pidnext)
+    if(*pp == p){
+      *pp = p->pidnext;
+      break;
+    }
+  p->state = UNUSED;
+  p->pidnext = ptable.free;
+  ptable.free = p;
 }
 
 // Must be called with interrupts disabled
@@ -66,7 +112,7 @@ myproc(void) {
 }
 
 //PAGEBREAK: 32
-// Look in the process table for an UNUSED proc.
+// Take an UNUSED proc from the free list.
 // If found, change state to EMBRYO and initialize
 // state required to run in the kernel.
 // Otherwise return 0.
@@ -77,30 +123,61 @@ allocproc(void)
   char *sp;
 
   acquire(&ptable.lock);
-
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
-      goto found;
-
-  release(&ptable.lock);
-  return 0;
-
-found:
+  if((p = ptable.free) == 0){
+    release(&ptable.lock);
+    return 0;
+  }
+  ptable.free = p->pidnext;
   p->state = EMBRYO;
   p->pid = nextpid++;
+  p->pidnext = *pidbucket(p->pid);
+  *pidbucket(p->pid) = p;
   p->sched_policy = -1; //default for round robin
   p->rate = 0; //only needed for rms
+  p->rmsprio = NRMSPRIO;
   p->deadline = 0;
   p->exec_time = 0;
   p->elapsed_time= 0;
+  p->jobcycles = 0;
+  p->ucycles = 0;
+  p->kcycles = 0;
+  p->wcycles = 0;
   p->arrival_time=0;
-
+  p->periodic = 0;
+  p->njobs = 0;
+  p->jobsdone = 0;
+  p->missed = 0;
+  p->nmisses = 0;
+  p->maxlate = 0;
+  p->totlate = 0;
+  p->maxresp = 0;
+  p->totresp = 0;
+  p->npreempts = 0;
+  p->affinity = ~0;
+  p->gang = 0;
+  p->fpuused = 0;
+  p->fpucpu = -1;
+  p->rtcpu = -1;
+  p->util = -1;
+  p->waitlock = 0;
+  p->ipolicy = SCHED_DEFAULT;
+  p->ideadline = 0;
+  p->iprio = NRMSPRIO;
+  p->rq = 0;
+  p->heapidx = -1;
+  p->mlfqlevel = 0;
+  p->quantum = QUANTUM;
+  p->tickets = NTICKETS;
+  p->stride = STRIDE1 / NTICKETS;
+  p->pass = 0;
 
   release(&ptable.lock);
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+    acquire(&ptable.lock);
+    procfree(p);
+    release(&ptable.lock);
     return 0;
   }
   sp = p->kstack + KSTACKSIZE;
@@ -156,6 +233,8 @@ userinit(void)
   acquire(&ptable.lock);
 
   p->state = RUNNABLE;
+  p->lastts = rdtsc();
+  runqadd(myrunq(), p, 0);
 
   release(&ptable.lock);
 }
@@ -200,10 +279,15 @@ fork(void)
   if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
     kfree(np->kstack);
     np->kstack = 0;
-    np->state = UNUSED;
+    acquire(&ptable.lock);
+    procfree(np);
+    release(&ptable.lock);
     return -1;
   }
   np->sz = curproc->sz;
+  np->affinity = curproc->affinity;
+  np->gang = curproc->gang;
+  fpufork(np);
   np->parent = curproc;
   *np->tf = *curproc->tf;
 
@@ -222,6 +306,8 @@ fork(void)
   acquire(&ptable.lock);
 
   np->state = RUNNABLE;
+  np->lastts = rdtsc();
+  runqadd(myrunq(), np, 0);
 
   release(&ptable.lock);
 
@@ -268,6 +354,8 @@ exit(void)
     }
   }
 
+  rtleave(curproc);
+
   // Jump into the scheduler, never to return.
   curproc->state = ZOMBIE;
   sched();
@@ -297,11 +385,14 @@ wait(void)
         kfree(p->kstack);
         p->kstack = 0;
         freevm(p->pgdir);
+        ptable.stats.ucycles += p->ucycles;
+        ptable.stats.kcycles += p->kcycles;
+        ptable.stats.wcycles += p->wcycles;
+        procfree(p);
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
         p->killed = 0;
-        p->state = UNUSED;
         release(&ptable.lock);
         return pid;
       }
@@ -330,73 +421,156 @@ wait(void)
 
 ////// --------------------------------------------------------
 
-struct proc* choose_round_robin(void)
+// Must be called with interrupts disabled.
+static struct runq*
+myrunq(void)
 {
-      struct proc *p, *best_p = 0;
-      for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-        if(p->state != RUNNABLE){continue;}
-        if (best_p==0){
-          best_p = p;
-        }else if (p->pid>best_p->pid){
-          best_p = p;
-        }
-      }
-      return best_p;
+  return &runqs[cpuid()];
+}
+
+// p was just queued on rq.  If rq's CPU is halted, wake it; if
+// it is running something p should preempt, make it reschedule
+// now rather than at its next tick.  Otherwise, unless p is
+// tied to that CPU, wake a halted peer so it can steal.  Caller
+// holds ptable.lock, so c->proc is stable.  idle() does not
+// take the lock, so the store to rq->nready must be visible
+// before c->idle is read, or both sides could miss each other
+// and c halt with p queued.
+void
+kick(struct runq *rq, struct proc *p)
+{
+  struct cpu *c = &cpus[rq - runqs];
+
+  __sync_synchronize();
+  if(!c->idle){
+    if(c->proc && c->proc != p && preempts(p, c->proc)){
+      c->resched = 1;
+      if(c != mycpu())
+        lapicipi(c->apicid, T_RESCHED);
+      return;
+    }
+    if(p->rtcpu >= 0 || (rq->nready == 1 && c->proc == p))
+      return;
+    for(c = cpus; c < &cpus[ncpu]; c++)
+      if(c->idle && CANRUN(p, c - cpus))
+        break;
+    if(c == &cpus[ncpu])
+      return;
+  }
+  if(c != mycpu())
+    lapicipi(c->apicid, T_WAKEUP);
 }
 
+// Has a more urgent process been queued for this CPU since it
+// last chose one?
+int
+needresched(void)
+{
+  int r;
 
+  pushcli();
+  r = mycpu()->resched;
+  popcli();
+  return r;
+}
 
+// The per-tick policy hooks trap.c calls for the process running
+// on this CPU.  The policy itself is in policy.c, shared with
+// schedsim; these only add the locking.  The unlocked tests are
+// safe because only this CPU changes a running process's job,
+// level and server, and the boost and gang times are re-checked.
+void
+deadlinetick(void)
+{
+  struct proc *p = myproc();
+  struct runq *rq = myrunq();
 
-struct proc* choose_edf_process(void)
+  if(rq->nedf == 0 && rq->rmsmap == 0 &&
+     (p == 0 || p->missed || !hasdeadline(p) || (int)ticks <= nextrelease(p)))
+    return;
+  acquire(&ptable.lock);
+  if(p)
+    misscheck(p);
+  queuemisses(rq);
+  release(&ptable.lock);
+}
+
+void
+mlfqtick(void)
 {
-    //cprintf("Inside choose func\n");
-    struct proc *p, *best_p=0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if((p->state == RUNNABLE || p->state == RUNNING) && p->sched_policy==0){
-        //cprintf("checking proc: %d\n", p->pid);
-        if(   best_p==0 || 
-              best_p->deadline+best_p->arrival_time>p->deadline+p->arrival_time ||
-              (best_p->deadline+best_p->arrival_time==p->deadline+p->arrival_time && best_p->pid>p->pid))
-        {  
-          best_p=p;
-        }
-      }
-    }
-    //cprintf("Scheduling process %d\n",best_p->pid);
-    return best_p;
+  if(ticks - ptable.lastboost >= BOOSTTICKS){
+    acquire(&ptable.lock);
+    mlfqboost();
+    release(&ptable.lock);
+  }
+  if(myproc())
+    mlfqcharge(myproc());
 }
 
-struct proc* choose_rm_process(void){
-    //cprintf("Inside choose func\n");
-    struct proc *p, *best_p=0;
-    int best_weight = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if((p->state == RUNNABLE || p->state == RUNNING) && p->sched_policy==1){
-        //cprintf("checking proc: %d\n", p->pid);
-        // Calculating Weight
-        double val = 3*(30-(p->rate))/29;
-        int val_int = val;
-        if (val-val_int*1.0 > 0){
-          val_int += 1;
-        }
-        int cur_weight = 1;
-        if (val_int>cur_weight){
-          cur_weight = val_int;
-        }
-
-        if (best_weight == 0){
-          best_p = p;
-          best_weight = cur_weight;
-        }else{
-          if (cur_weight< best_weight || (cur_weight==best_weight && p->pid< best_p->pid)){
-              best_p = p;
-              best_weight = cur_weight;
-          }
-        }
-      }
-    }
-    //cprintf("Scheduling process %d\n",best_p->pid);
-    return best_p;
+void
+cbstick(void)
+{
+  struct runq *rq = mycpu()->server;
+
+  if(rq == 0)
+    return;
+  acquire(&ptable.lock);
+  cbscharge(rq);
+  release(&ptable.lock);
+}
+
+void
+gangtick(void)
+{
+  if(ticks - ptable.gangstart < GANGSLICE)
+    return;
+  acquire(&ptable.lock);
+  gangrotate();
+  release(&ptable.lock);
+}
+
+// Nothing to run or steal: halt until an interrupt.  The idle
+// flag is set before the queues are looked at again, so a
+// runqadd() that comes later sees it and sends a wakeup IPI.
+// After a failed steal, only this CPU's own queue is looked at.
+static void
+idle(struct cpu *c, struct runq *rq, int trysteal)
+{
+  uint64 t;
+
+  cli();
+  c->idle = 1;
+  __sync_synchronize();
+  if(rq->nready == 0 && (!trysteal || stealfrom(rq - runqs) == 0)){
+    t = rdtsc();
+    c->idlestart = t;
+    stihlt();
+    c->idlestart = 0;
+    c->idletsc += rdtsc() - t;
+  }
+  c->idle = 0;
+  sti();
+}
+
+// Copy idle time for up to n CPUs into st; returns how many.
+int
+getcpustat(struct cpustat *st, int n)
+{
+  struct cpu *c;
+  uint64 t;
+  int i;
+
+  pushcli();
+  for(i = 0; i < ncpu && i < n; i++){
+    c = &cpus[i];
+    st[i].tsc = rdtsc();
+    st[i].idle = c->idletsc;
+    t = c->idlestart;
+    if(t)
+      st[i].idle += st[i].tsc - t;
+  }
+  popcli();
+  return i;
 }
 
 ////// --------------------------------------------------------
@@ -407,44 +581,66 @@ scheduler(void)
   //cprintf("Inside scheduler \n");
   struct proc *p;
   struct cpu *c = mycpu();
+  struct runq *rq = myrunq(), *from, *q;
+  uint64 now;
   c->proc = 0;
   
   for(;;){
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
+    // Peek at the queues without locks so that an idle
+    // CPU does not keep bouncing ptable.lock.
+    from = stealfrom(rq - runqs);
+    if(rq->nready == 0 && from == 0){
+      idle(c, rq, 1);
+      continue;
+    }
+    timerbusy();
+
     acquire(&ptable.lock);
-    int policy = -1;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if (p->state==RUNNABLE && p->sched_policy!=-1){
-        policy = p->sched_policy;
-        break;
-      }
+    p = 0;
+    c->server = 0;
+    if(from && (p = stealable(from, rq - runqs)) == 0 &&
+       rq->nready == 0){
+      // Another CPU got there first.
+      release(&ptable.lock);
+      idle(c, rq, 0);
+      continue;
     }
+    if(p == 0)
+      p = choose(rq);
 
     // Switch to chosen process.  It is the process's job
     // to release ptable.lock and then reacquire it
     // before jumping back to us.
-    
-    if (policy == -1){
-      p = choose_round_robin();
-    }else if (policy == 0){
-      //cprintf("curr policy is %d\n", policy);
-      //cprintf("Calling choose func\n");
-      p = choose_edf_process();
-    } else{
-      //cprintf("Calling choose func\n");
-      p = choose_rm_process();
-    }
-
     if (p){
+      q = runqdel(p);
+      if(p->sched_policy == SCHED_STRIDE){
+        q->vtime = p->pass;
+        p->pass += p->stride;
+      }
       c->proc = p;
+      c->resched = 0;
       switchuvm(p);
+      fpuswitch(p);
       p->state = RUNNING;
+      misscheck(p);
+      TRACE(TR_SWITCHIN, p->pid, 0);
+      now = rdtsc();
+      p->wcycles += now - p->lastts;
+      p->lastts = now;
+      budgettimer(p);
 
       swtch(&(c->scheduler), p->context);
+      fpusave(p);
+      cputime(p, 0);
       switchkvm();
+      TRACE(TR_SWITCHOUT, p->pid, p->state);
+      if(p->state == RUNNABLE && SCHED_RT(p->sched_policy)){
+        p->npreempts++;
+        ptable.stats.preempts++;
+      }
 
       // Process is done running for now.
       // It should have changed its p->state before coming back.
@@ -488,10 +684,118 @@ yield(void)
 {
   acquire(&ptable.lock);  //DOC: yieldlock
   myproc()->state = RUNNABLE;
+  runqadd(myrunq(), myproc(), 1);
   sched();
   release(&ptable.lock);
 }
 
+// Charge the TSC cycles since p->lastts to p, as user time if
+// user is set.  Called for the running process when it enters
+// or leaves the kernel and when it is switched out; the time
+// between being made RUNNABLE and switched in is wait time.
+void
+cputime(struct proc *p, int user)
+{
+  uint64 now = rdtsc();
+  uint64 d = now - p->lastts;
+
+  if(user)
+    p->ucycles += d;
+  else
+    p->kcycles += d;
+  p->jobcycles += d;
+  p->lastts = now;
+}
+
+// Has p's current job used up its exec_time budget?  Measured
+// in TSC cycles, or in whole ticks if the TSC is not calibrated.
+int
+overbudget(struct proc *p)
+{
+  uint64 budget = ticks2cycles(p->exec_time);
+
+  if(budget == 0)
+    return p->elapsed_time >= p->exec_time;
+  return p->jobcycles >= budget;
+}
+
+// Ask for a timer interrupt when the running real-time process
+// p will use up its budget, so it is stopped then rather than at
+// the next tick.
+void
+budgettimer(struct proc *p)
+{
+  uint64 budget = ticks2cycles(p->exec_time);
+
+  if(SCHED_RT(p->sched_policy) && budget > p->jobcycles)
+    timeralarm(p->lastts + budget - p->jobcycles);
+}
+
+// The current job of p has used up its budget.
+void
+jobcomplete(struct proc *p)
+{
+  acquire(&ptable.lock);
+  jobend(p);
+  release(&ptable.lock);
+}
+
+// Copy the statistics of pid, or with pid 0 the system-wide
+// totals, into st.
+int
+getstats(int pid, struct schedstats *st)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  if(pid == 0){
+    *st = ptable.stats;
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+      if(p->state == UNUSED)
+        continue;
+      st->ucycles += p->ucycles;
+      st->kcycles += p->kcycles;
+      st->wcycles += p->wcycles;
+    }
+    release(&ptable.lock);
+    return 0;
+  }
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -22;
+  }
+  st->jobs = p->jobsdone;
+  st->misses = p->nmisses;
+  st->maxlate = p->maxlate;
+  st->totlate = p->totlate;
+  st->maxresp = p->maxresp;
+  st->totresp = p->totresp;
+  st->preempts = p->npreempts;
+  st->ucycles = p->ucycles;
+  st->kcycles = p->kcycles;
+  st->wcycles = p->wcycles;
+  release(&ptable.lock);
+  return 0;
+}
+
+// The current job of a periodic task has used up its budget.
+// Start the next job and sleep until its release.  A job that
+// finished late is released at once.
+void
+jobdone(void)
+{
+  struct proc *p = myproc();
+  int next;
+
+  acquire(&ptable.lock);
+  next = jobnext(p);
+  release(&ptable.lock);
+
+  acquire(&tickslock);
+  sleepuntil(next);
+  release(&tickslock);
+}
+
 // A fork child's very first scheduling by scheduler()
 // will swtch here.  "Return" to user space.
 void
@@ -513,6 +817,41 @@ forkret(void)
   // Return to "caller", actually trapret (see allocproc).
 }
 
+// SLEEPING processes are kept on hashed queues by channel, so
+// wakeup only looks at processes that may be waiting on chan.
+// Caller holds ptable.lock.
+static struct proc**
+chanbucket(void *chan)
+{
+  uint h = (uint)chan;
+
+  return &ptable.sleepq[(h >> 2 ^ h >> 12) & (NCHANHASH-1)];
+}
+
+static void
+sleepadd(struct proc *p)
+{
+  struct proc **head = chanbucket(p->chan);
+
+  p->chprev = 0;
+  p->chnext = *head;
+  if(*head)
+    (*head)->chprev = p;
+  *head = p;
+}
+
+static void
+sleepdel(struct proc *p)
+{
+  if(p->chprev)
+    p->chprev->chnext = p->chnext;
+  else
+    *chanbucket(p->chan) = p->chnext;
+  if(p->chnext)
+    p->chnext->chprev = p->chprev;
+  p->chnext = p->chprev = 0;
+}
+
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void
@@ -539,6 +878,7 @@ sleep(void *chan, struct spinlock *lk)
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  sleepadd(p);
 
   sched();
 
@@ -558,11 +898,17 @@ sleep(void *chan, struct spinlock *lk)
 static void
 wakeup1(void *chan)
 {
-  struct proc *p;
+  struct proc *p, *next;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
+  for(p = *chanbucket(chan); p; p = next){
+    next = p->chnext;
+    if(p->chan == chan){
+      sleepdel(p);
       p->state = RUNNABLE;
+      p->lastts = rdtsc();
+      runqadd(myrunq(), p, 0);
+    }
+  }
 }
 
 // Wake up all processes sleeping on chan.
@@ -574,6 +920,83 @@ wakeup(void *chan)
   release(&ptable.lock);
 }
 
+// Priority inheritance for sleep locks.  p->waitlock, and
+// lk->owner while lk has waiters, change only under ptable.lock,
+// so the chain of owners can be followed here.  Uncontended
+// locks never get here; see sleeplock.c.
+
+// Recompute what p inherits from the processes waiting for the
+// sleep locks it holds, requeue it if that changed, and carry
+// the change on to the owner of the lock p itself waits for.
+// Caller holds ptable.lock.
+static void
+inherit(struct proc *p)
+{
+  struct proc *w;
+  struct runq *rq;
+  int pol, dl, prio, n;
+
+  for(n = 0; p && n < NPROC; n++){
+    pol = SCHED_DEFAULT;
+    dl = 0;
+    prio = NRMSPRIO;
+    for(w = ptable.proc; w < &ptable.proc[NPROC]; w++){
+      if(w->waitlock == 0 || w->waitlock->owner != p)
+        continue;
+      if(qpolicy(w) == SCHED_EDF){
+        if(pol != SCHED_EDF || edfkey(w) < dl)
+          dl = edfkey(w);
+        pol = SCHED_EDF;
+      } else if(qpolicy(w) == SCHED_RMS){
+        if(rmskey(w) < prio)
+          prio = rmskey(w);
+        if(pol != SCHED_EDF)
+          pol = SCHED_RMS;
+      }
+    }
+    if(pol == p->ipolicy && dl == p->ideadline && prio == p->iprio)
+      break;
+    rq = 0;
+    if(p->state == RUNNABLE)
+      rq = runqdel(p);
+    p->ipolicy = pol;
+    p->ideadline = dl;
+    p->iprio = prio;
+    if(rq)
+      runqadd(rq, p, 0);
+    p = p->waitlock ? p->waitlock->owner : 0;
+  }
+}
+
+// The current process is about to sleep waiting for lk.
+// Caller holds lk->lk.
+void
+lockwait(struct sleeplock *lk)
+{
+  acquire(&ptable.lock);
+  myproc()->waitlock = lk;
+  inherit(lk->owner);
+  release(&ptable.lock);
+}
+
+// lk changes hands to p, or to nobody if p is 0.  The old owner
+// loses what it inherited through lk; p gains from the processes
+// still waiting.  Caller holds lk->lk.
+void
+lockowner(struct sleeplock *lk, struct proc *p)
+{
+  struct proc *old;
+
+  acquire(&ptable.lock);
+  old = lk->owner;
+  lk->owner = p;
+  if(p)
+    p->waitlock = 0;
+  inherit(old);
+  inherit(p);
+  release(&ptable.lock);
+}
+
 // Kill the process with the given pid.
 // Process won't exit until it returns
 // to user space (see trap in trap.c).
@@ -583,18 +1006,20 @@ kill(int pid)
   struct proc *p;
 
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
-    }
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  p->killed = 1;
+  // Wake process from sleep if necessary.
+  if(p->state == SLEEPING){
+    sleepdel(p);
+    p->state = RUNNABLE;
+    p->lastts = rdtsc();
+    runqadd(myrunq(), p, 0);
   }
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
 
 //PAGEBREAK: 36
@@ -637,148 +1062,393 @@ procdump(void)
 
 ///////////////////////////////////////
 
+// The parameter setters refuse values no task could use, and
+// for an admitted task any that would make its own parameters
+// inconsistent, before anything is refunded.
 int set_exec_time(int pid, int exec_time){
   struct proc *p;
+  if(exec_time <= 0 || exec_time > MAXRTTICKS)
+    return -22;
   acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->pid==pid){
-        p->exec_time=exec_time;
-        release(&ptable.lock);
-        return 0;
-      }
-      
-    }
+  if((p = findproc(pid)) == 0 || (p->rtcpu >= 0 &&
+     !rtvalid(p->sched_policy, exec_time, p->deadline, p->rate))){
     release(&ptable.lock);
     return -22;
+  }
+  rtrefund(p);
+  p->exec_time=exec_time;
+  rtcharge(p);
+  rmsstale();
+  release(&ptable.lock);
+  return 0;
 }
 
 int set_rate(int pid, int rate){
   struct proc *p;
+  struct runq *rq;
+  int admitted;
+  if(rate < 1 || rate > 30)
+    return -22;
   acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->pid==pid){
-        p->rate=rate;
-        p->killed=0;
-        release(&ptable.lock);
-        return 0;
-      }
-      
-    }
+  if((p = findproc(pid)) == 0 || (p->rtcpu >= 0 &&
+     !rtvalid(p->sched_policy, p->exec_time, p->deadline, rate))){
     release(&ptable.lock);
     return -22;
+  }
+  rq = 0;
+  if(p->state == RUNNABLE)
+    rq = runqdel(p);
+  admitted = rmsleave(p);
+  rtrefund(p);
+  p->rate=rate;
+  p->rmsprio=rmsprio(rate);
+  rtcharge(p);
+  if(admitted){
+    rmsinsert(p);
+    rmsstale();
+  }
+  if(rq)
+    runqadd(rq, p, 0);
+  if(p->waitlock)
+    inherit(p->waitlock->owner);
+  p->killed=0;
+  release(&ptable.lock);
+  return 0;
+}
+
+// Give pid a stride share of tickets.
+int
+set_tickets(int pid, int tickets)
+{
+  struct proc *p;
+  struct runq *rq;
+
+  if(tickets < 1 || tickets > STRIDE1)
+    return -22;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -22;
+  }
+  rq = 0;
+  if(p->state == RUNNABLE)
+    rq = runqdel(p);
+  p->tickets = tickets;
+  p->stride = STRIDE1 / tickets;
+  if(rq)
+    runqadd(rq, p, 0);
+  release(&ptable.lock);
+  return 0;
 }
 
 int set_deadline(int pid, int deadline){
   struct proc *p;
+  struct runq *rq;
+  if(deadline <= 0 || deadline > MAXRTTICKS)
+    return -22;
   acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->pid==pid){
-        p->deadline=deadline;
-        p->killed=0;
-        release(&ptable.lock);
-        return 0;
-      }
-      
-    }
+  if((p = findproc(pid)) == 0 || (p->rtcpu >= 0 &&
+     !rtvalid(p->sched_policy, p->exec_time, deadline, p->rate))){
     release(&ptable.lock);
     return -22;
+  }
+  rq = 0;
+  if(p->state == RUNNABLE)
+    rq = runqdel(p);
+  rtrefund(p);
+  p->deadline=deadline;
+  rtcharge(p);
+  rmsstale();
+  if(rq)
+    runqadd(rq, p, 0);
+  if(p->waitlock)
+    inherit(p->waitlock->owner);
+  p->killed=0;
+  release(&ptable.lock);
+  return 0;
+}
+
+// Switch p to policy and release its first job now.  Caller
+// holds ptable.lock and has taken p off its run queue.
+static void
+setpolicy(struct proc *p, int policy, int flags)
+{
+  rtleave(p);
+  p->mlfqlevel=0;
+  p->quantum=mlfqquantum(0);
+  p->sched_policy=policy;
+  p->rmsprio=rmsprio(p->rate);
+  p->arrival_time=ticks;
+  p->periodic=(flags & SCHED_PERIODIC) != 0;
+  p->firstrelease=p->arrival_time;
+  p->njobs=1;
+  p->jobsdone=0;
+  p->missed=0;
+  if(SCHED_RT(policy))
+    TRACE(TR_RELEASE, p->pid, p->arrival_time);
 }
 
-int set_sched_policy(int pid, int policy){
+int set_sched_policy(int pid, int policy, int flags){
   struct proc *p;
+  struct runq *rq;
   acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->pid==pid){
-        p->sched_policy=policy;
-        p->arrival_time=ticks;
-        //cprintf("arrival time for pid %d is %d\n", p->pid, p->arrival_time);
-        release(&ptable.lock);
-        return 0;
-      }
-    }
+  if((p = findproc(pid)) == 0){
     release(&ptable.lock);
     return -22;
+  }
+  rq = 0;
+  if(p->state == RUNNABLE)
+    rq = runqdel(p);
+  setpolicy(p, policy, flags);
+  if(rq)
+    runqadd(rq, p, 0);
+  if(p->waitlock)
+    inherit(p->waitlock->owner);
+  //cprintf("arrival time for pid %d is %d\n", p->pid, p->arrival_time);
+  release(&ptable.lock);
+  return 0;
+}
+
+// Admission failed.  p goes back to the default policy and is
+// killed, so it exits like any other process and its parent's
+// wait() frees it.  Caller holds ptable.lock.
+static void
+reject(struct proc *p)
+{
+  struct runq *rq;
+
+  TRACE(TR_REJECT, p->pid, 0);
+  rq = 0;
+  if(p->rq)
+    rq = runqdel(p);
+  setpolicy(p, SCHED_DEFAULT, 0);
+  p->killed = 1;
+  if(p->state == SLEEPING){
+    sleepdel(p);
+    p->state = RUNNABLE;
+    p->lastts = rdtsc();
+    rq = myrunq();
+  }
+  if(rq)
+    runqadd(rq, p, 0);
+  if(p->waitlock)
+    inherit(p->waitlock->owner);
 }
 
 int is_edf_schedulable(int pid){
-  int utility_sum=0;
   struct proc *p;
+  int ok;
   acquire(&ptable.lock);
-    //cprintf("Starting check\n");
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->sched_policy==0 && (p->state==RUNNABLE || p->state== RUNNING)){
-        utility_sum+=100*p->exec_time/p->deadline;
-        //cprintf("Current utility: %d after adding for pid: %d\n",utility_sum,p->pid);
-      }
-      
-    }
-    if(utility_sum>100){
-      for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-        if(p->pid==pid){
-          p->state=UNUSED;
-          break;
-        }
-      }
+    if((p = findproc(pid)) == 0){
+      release(&ptable.lock);
+      return -22;
     }
+    rtleave(p);
+    ok = -22;
+    if(rtvalid(SCHED_EDF, p->exec_time, p->deadline, p->rate))
+      ok = admit(p, SCHED_RTA);
+    if(ok < 0)
+      reject(p);
     release(&ptable.lock);
-    //cprintf("Starting check\n");
-    if (utility_sum<=100) return 0;
+    if (ok == 0) return 0;
     return -22;
 }
 
-double nth_root_2( int n) { 
-  double lower = 0; 
-  double upper = 2.0; 
-  double mid; 
-  double precision = 0.0001; 
-  double abs_diff = 0.0; 
-  abs_diff = upper - lower; 
-  if (abs_diff < 0){ 
-    abs_diff *= -1.0; 
-  } 
-  while (abs_diff > precision) { 
-    mid = lower + (upper - lower)/ 2.0; 
-    double power = 1; 
-    for (int i = 0; i < n; i++) { 
-      power *= mid; 
-      } 
-      if (power > 2.0) { 
-        upper = mid; 
-      } else { lower = mid; } 
-      abs_diff = upper - lower; 
-      if (abs_diff < 0){ abs_diff *= -1.0; } 
-      
-  } 
-  return (lower + upper) / 2; 
-  }
-
-int is_rms_schedulable(int pid){
-  int utility_sum=0;
-  int num_proc=0;
+int is_rms_schedulable(int pid, int test){
   struct proc *p;
+
   acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->sched_policy==1 && (p->state==RUNNABLE || p->state==RUNNING)){
-        utility_sum+=p->exec_time*p->rate;
-        num_proc++;
-      }
-    }
-    int max_util = 100*num_proc*(nth_root_2(num_proc)-1);
-    if(utility_sum>max_util){
-      for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-        if(p->pid==pid){
-          p->state=UNUSED;
-          break;
-        }
-      }
-    }
+  if((p = findproc(pid)) == 0){
     release(&ptable.lock);
+    return -22;
+  }
+
+  rtleave(p);
+  if(!rtvalid(SCHED_RMS, p->exec_time, p->deadline, p->rate) ||
+     admit(p, test) < 0){
+    reject(p);
+    release(&ptable.lock);
+    return -22;
+  }
+  release(&ptable.lock);
+  return 0;
+}
+
+// Are a's parameters usable by its policy?
+static int
+attrvalid(struct sched_attr *a)
+{
+  int policy = a->policy;
+
+  if(policy >= 0)
+    policy &= ~SCHED_FLAGS;
+  switch(policy){
+  case SCHED_DEFAULT:
+    return 1;
+  case SCHED_EDF:
+  case SCHED_RMS:
+    return rtvalid(policy, a->exec_time, a->deadline, a->rate);
+  case SCHED_STRIDE:
+    return a->tickets >= 1 && a->tickets <= STRIDE1;
+  }
+  return 0;
+}
 
+// Apply a to p and, for EDF and RMS, admit it, all under one
+// hold of ptable.lock so that p is never scheduled with half
+// its parameters.  A rejected task is dropped, as with
+// sched_policy().
+static int
+setattr(struct proc *p, struct sched_attr *a)
+{
+  struct runq *rq;
+  int policy, flags;
+
+  policy = a->policy;
+  flags = 0;
+  if(policy >= 0){
+    flags = policy & SCHED_FLAGS;
+    policy &= ~SCHED_FLAGS;
+  }
+  rq = 0;
+  if(p->state == RUNNABLE)
+    rq = runqdel(p);
+  p->exec_time = a->exec_time;
+  if(policy == SCHED_EDF)
+    p->deadline = a->deadline;
+  if(policy == SCHED_RMS)
+    p->rate = a->rate;
+  if(policy == SCHED_STRIDE){
+    p->tickets = a->tickets;
+    p->stride = STRIDE1 / a->tickets;
+  }
+  setpolicy(p, policy, flags);
+  rmsstale();
+  if(rq)
+    runqadd(rq, p, 0);
+  if(p->waitlock)
+    inherit(p->waitlock->owner);
+  if(SCHED_RT(policy) && admit(p, flags & SCHED_TESTMASK) < 0){
+    reject(p);
+    return -22;
+  }
+  return 0;
+}
 
-    //cprintf("Got max_util %d for num proc= %d and utility_sum = %d\n", max_util, num_proc, utility_sum);
-    if (utility_sum<=max_util) return 0;
-   
+int
+sched_setattr(int pid, struct sched_attr *a)
+{
+  struct proc *p;
+  int r;
+
+  if(!attrvalid(a))
     return -22;
+  acquire(&ptable.lock);
+  r = -22;
+  if((p = findproc(pid)) != 0)
+    r = setattr(p, a);
+  release(&ptable.lock);
+  return r;
 }
 
+// Configure pids[i] with a[i] for each i in turn, stopping at
+// the first that is missing, invalid or not admitted.  Returns
+// the number configured.
+int
+sched_setattrs(int *pids, struct sched_attr *a, int n)
+{
+  struct proc *p;
+  int i;
 
+  acquire(&ptable.lock);
+  for(i = 0; i < n; i++){
+    if(!attrvalid(&a[i]) || (p = findproc(pids[i])) == 0)
+      break;
+    if(setattr(p, &a[i]) < 0)
+      break;
+  }
+  release(&ptable.lock);
+  return i;
+}
+
+// Restrict pid to the CPUs in mask.  An admitted real-time task
+// whose CPU is not in the new mask is admitted again within it,
+// and keeps the old mask if it does not fit.  A process running
+// elsewhere moves when it next yields.
+int
+set_affinity(int pid, uint mask)
+{
+  struct proc *p;
+  struct runq *rq;
+  uint old;
+  int r;
+
+  mask &= (1 << ncpu) - 1;
+  if(mask == 0)
+    return -22;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -22;
+  }
+  rq = 0;
+  if(p->state == RUNNABLE)
+    rq = runqdel(p);
+  old = p->affinity;
+  p->affinity = mask;
+  r = 0;
+  if(p->rtcpu >= 0 && !CANRUN(p, p->rtcpu)){
+    rtleave(p);
+    if(admit(p, SCHED_RTA) < 0){
+      r = -22;
+      p->affinity = old;
+      if(admit(p, SCHED_RTA) < 0)
+        reject(p);
+    }
+  }
+  if(rq)
+    runqadd(rq, p, 0);
+  release(&ptable.lock);
+  return r;
+}
+
+int
+get_affinity(int pid)
+{
+  struct proc *p;
+  int mask;
+
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -22;
+  }
+  mask = p->affinity & ((1 << ncpu) - 1);
+  release(&ptable.lock);
+  return mask;
+}
+
+// Put pid in process group gang, or in none if gang is 0.
+// Children inherit the group.  See gangrotate() in policy.c.
+int
+set_gang(int pid, int gang)
+{
+  struct proc *p;
+  struct runq *rq;
+
+  if(gang < 0)
+    return -22;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -22;
+  }
+  rq = 0;
+  if(p->state == RUNNABLE)
+    rq = runqdel(p);
+  p->gang = gang;
+  if(rq)
+    runqadd(rq, p, 0);
+  release(&ptable.lock);
+  return 0;
+}
@@ -8,6 +8,14 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  uint64 timerat;              // TSC time the APIC timer is armed for, or 0
+  uint lasttick;               // ticks at this cpu's last timer interrupt
+  struct runq *server;         // Queue whose CBS is paying for proc, or 0
+  volatile int idle;           // Halted in scheduler(), or about to be
+  struct proc *fpuowner;       // Process whose FPU state is loaded, or 0
+  int resched;                 // proc should yield; set under ptable.lock
+  volatile uint64 idlestart;   // TSC when the current halt began, or 0
+  uint64 idletsc;              // TSC cycles spent halted
 };
 
 extern struct cpu cpus[NCPU];
@@ -53,9 +61,49 @@ struct proc {
   int deadline;
   int rate;
   int sched_policy;            //-1 for default, 0 for edf, 1 for rms
-  int elapsed_time;
-  int arrival_time;
-
+  int rmsprio;                 // RMS static priority, 1 is most urgent
+  int rmsresp;                 // RMS worst-case response time (ticks)
+  int elapsed_time;            // Ticks run, for budgets without a TSC
+  int arrival_time;            // Release time of the current job
+  int periodic;                // Re-release every period instead of exiting
+  int firstrelease;            // Release time of the first job
+  int njobs;                   // Jobs released
+  int jobsdone;                // Jobs that used up their budget
+  int missed;                  // Current job has passed its deadline
+  int nmisses;                 // Statistics for sched_stats()
+  int maxlate;
+  int totlate;
+  int maxresp;
+  int totresp;
+  int npreempts;
+  uint affinity;               // CPUs p may run on, bit i for cpu i
+  int rtcpu;                   // CPU an admitted real-time task runs on, or -1
+  int util;                    // Utilisation charged to rtcpu, or -1
+  struct sleeplock *waitlock;  // Sleep lock p is waiting for, or 0
+  int ipolicy;                 // Most urgent policy inherited from waiters
+  int ideadline;               // Inherited EDF deadline
+  int iprio;                   // Inherited RMS priority
+  struct runq *rq;             // Run queue holding p while RUNNABLE
+  int heapidx;                 // Slot in rq's EDF or stride heap, or -1
+  int mlfqlevel;               // MLFQ level of a default process, 0 is top
+  int quantum;                 // Ticks left at that level
+  int gang;                    // Process group, gang-scheduled, or 0
+  int tickets;                 // Stride share
+  int stride;                  // STRIDE1 / tickets
+  uint pass;                   // Stride virtual time
+  struct proc *rqnext;         // rq's non-EDF ready list
+  struct proc *rqprev;
+  struct proc *pidnext;        // ptable's pid hash chain, or free list
+  struct proc *chnext;         // ptable's sleep queue while SLEEPING
+  struct proc *chprev;
+  uint64 lastts;               // TSC when p last changed state or mode
+  uint64 jobcycles;            // TSC cycles run by the current job
+  uint64 ucycles;              // TSC cycles run in user mode
+  uint64 kcycles;              // in the kernel
+  uint64 wcycles;              // waiting RUNNABLE
+  int fpuused;                 // fpu holds p's state, else it has none yet
+  int fpucpu;                  // CPU p's FPU state was last loaded on, or -1
+  uchar fpu[512] __attribute__((aligned(16)));  // FXSAVE area; see fpu.c
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -0,0 +1,123 @@
+// Process table and per-CPU run queues, shared by proc.c, which
+// runs processes, and policy.c, which orders them and admits
+// real-time tasks.  policy.c also builds on the host, for the
+// schedsim simulator.
+// Needs spinlock.h, proc.h and sched.h.
+
+struct ptable {
+  struct spinlock lock;
+  struct proc proc[NPROC];
+  struct proc *rms[NPROC];  // admitted RMS tasks, by priority then pid
+  int nrms;
+  struct schedstats stats;    // summed over all tasks
+  int uedf[NCPU];             // utilisation of each CPU's admitted EDF
+  int urt[NCPU];              // and of all its admitted tasks, in UTIL1s
+  int nedf[NCPU];             // admitted EDF tasks on each CPU
+  struct proc *pidhash[NPIDHASH];  // live processes by pid
+  struct proc *sleepq[NCHANHASH];  // SLEEPING processes by chan
+  struct proc *free;          // UNUSED slots
+  uint lastboost;             // ticks at the last MLFQ boost
+  int gang;                   // process group being gang-scheduled, or 0
+  uint gangstart;             // ticks when its slot began
+};
+
+extern struct ptable ptable;
+
+#define UTIL1 10000             // utilisation 1, fixed point
+
+// Per-CPU run queues.  Every RUNNABLE process sits on exactly
+// one CPU's queue (p->rq): EDF processes in a binary min-heap
+// ordered by absolute deadline (arrival_time + deadline, ties
+// broken by lower pid), RMS processes in per-priority FIFO
+// lists indexed by a bitmap of non-empty priorities, stride
+// processes in a min-heap ordered by pass, everything else in a
+// multi-level feedback queue: one FIFO list per level and a
+// bitmap of non-empty levels.  Stride and default processes are
+// the best-effort ones; those in a process group (p->gang) are
+// instead on one FIFO gang list.
+//
+// A process is queued on the CPU that made it RUNNABLE (fork,
+// wakeup, yield), except that an admitted real-time task is
+// always queued on its own CPU (p->rtcpu) and any other process
+// on the first CPU of its affinity mask if that one is not in
+// it.  CPUs that run dry steal best-effort processes allowed to
+// run on them from the busiest peer that has one (nsteal).
+// The queues are per-CPU for locality and so that each CPU's
+// choice costs O(1), but they are not separately locked: like
+// p->state, which every queue operation goes with, they are
+// only touched under ptable.lock.  So enqueue, pick and steal
+// still serialise on that one lock across CPUs, and scheduler
+// throughput does not scale with the number of CPUs; only the
+// work done under the lock is smaller.  stealfrom() and the
+// scheduler's emptiness check peek without it and re-check, so
+// idle CPUs do not contend for it.
+//
+// Each queue also has a Constant Bandwidth Server, off unless
+// sched_server() sets a budget: while EDF tasks are queued, the
+// best-effort processes run as one EDF entity with the server's
+// deadline, for at most cbsbudget ticks every cbsperiod.
+struct runq {
+  struct proc *edf[NPROC];     // EDF ready heap
+  int nedf;
+  uint rmsmap;                 // bit i set if rmshead[i] non-empty
+  struct proc *rmshead[NRMSPRIO];
+  struct proc *rmstail[NRMSPRIO];
+  int nrms;
+  struct proc *stride[NPROC];  // stride heap
+  int nstride;
+  uint vtime;                  // pass of the last stride process run
+  uint mlfqmap;                // bit l set if mlfqhead[l] non-empty
+  struct proc *mlfqhead[NMLFQ];
+  struct proc *mlfqtail[NMLFQ];
+  struct proc *ganghead;       // best-effort processes in a group
+  struct proc *gangtail;
+  int nready;                  // all processes on this queue
+  int nsteal[NCPU];            // best-effort ones each CPU may run
+  int cbsleft;                 // server budget left, in ticks
+  int cbsdeadline;             // server's absolute deadline
+};
+
+// May p run on cpu?
+#define CANRUN(p, cpu) ((p)->affinity >> (cpu) & 1)
+
+// Is p queued on the gang list?
+#define GANGED(p) ((p)->gang && !SCHED_RT(qpolicy(p)))
+
+extern struct runq runqs[NCPU];
+extern int cbsbudget, cbsperiod;
+
+// policy.c
+int             admit(struct proc*, int);
+void            cbscharge(struct runq*);
+struct proc*    choose(struct runq*);
+struct proc*    choose_best_effort(struct runq*);
+int             edfkey(struct proc*);
+void            gangrotate(void);
+int             hasdeadline(struct proc*);
+void            jobend(struct proc*);
+int             jobnext(struct proc*);
+void            misscheck(struct proc*);
+void            mlfqboost(void);
+void            mlfqcharge(struct proc*);
+int             mlfqquantum(int);
+int             nbest(struct runq*);
+int             nextrelease(struct proc*);
+void            queuemisses(struct runq*);
+int             preempts(struct proc*, struct proc*);
+int             qpolicy(struct proc*);
+void            rmsinsert(struct proc*);
+int             rmskey(struct proc*);
+int             rmsleave(struct proc*);
+int             rmsprio(int);
+void            rmsstale(void);
+void            rtcharge(struct proc*);
+void            rtleave(struct proc*);
+void            rtrefund(struct proc*);
+int             rtvalid(int, int, int, int);
+void            runqadd(struct runq*, struct proc*, int);
+struct runq*    runqdel(struct proc*);
+struct proc*    stealable(struct runq*, int);
+struct runq*    stealfrom(int);
+
+// proc.c, or the simulator's stand-in
+void            kick(struct runq*, struct proc*);
@@ -0,0 +1,67 @@
+// Scheduling policies, for sched_policy().
+#define SCHED_DEFAULT  -1   // round robin
+#define SCHED_EDF       0   // earliest deadline first
+#define SCHED_RMS       1   // rate monotonic
+#define SCHED_STRIDE    2   // proportional share, see tickets()
+#define SCHED_RT(policy) ((policy) == SCHED_EDF || (policy) == SCHED_RMS)
+
+// Flags or'ed into the policy.
+#define SCHED_RTA      0x000  // RMS admission by response-time analysis
+#define SCHED_HB       0x100  // RMS admission by hyperbolic bound
+#define SCHED_TESTMASK 0x100
+#define SCHED_PERIODIC 0x200  // release a new job every period
+#define SCHED_FLAGS    0x300
+
+// All of a task's scheduling parameters, for sched_setattr().
+// policy takes the SCHED_* flags as for sched_policy().  Only the
+// fields the policy uses are checked: deadline for EDF, rate (1
+// to 30) for RMS, tickets for stride, and exec_time for EDF and
+// RMS.
+struct sched_attr {
+  int policy;
+  int exec_time;
+  int deadline;
+  int rate;
+  int tickets;
+};
+
+// Real-time statistics from sched_stats(), per task or, for
+// pid 0, summed over every task since boot.  Times are in ticks.
+struct schedstats {
+  int jobs;       // jobs that used up their budget
+  int misses;     // jobs that ran past their deadline
+  int maxlate;    // worst completion time past the deadline
+  int totlate;
+  int maxresp;    // worst time from release to completion
+  int totresp;
+  int preempts;   // times switched out while still runnable
+  uint64 ucycles; // TSC cycles run in user mode, in the kernel, and
+  uint64 kcycles; // waiting to run; for pid 0, summed over every
+  uint64 wcycles; // process, live or reaped, not just real-time ones
+};
+
+// Per-CPU idle time from cpustat(), in TSC cycles.  The
+// fraction of the CPU used between two samples is
+// 1 - (idle1 - idle0) / (tsc1 - tsc0).
+struct cpustat {
+  uint64 idle;
+  uint64 tsc;
+};
+
+// Scheduler trace events, drained with schedtrace().
+// The kernel records them only if built with TRACE=1.
+#define TR_SWITCHIN    1   // pid starts running on cpu
+#define TR_SWITCHOUT   2   // pid stops running; arg is its new state
+#define TR_RELEASE     3   // job queued; arg is its release tick
+#define TR_COMPLETE    4   // job used its budget; arg is its release tick
+#define TR_MISS        5   // job passed its deadline; arg is the deadline
+#define TR_REJECT      6   // admission test rejected pid
+
+struct schedevent {
+  uint64 tsc;      // TSC when the event happened
+  uint tick;       // ticks when the event happened
+  ushort type;     // TR_*
+  ushort cpu;
+  int pid;
+  int arg;
+};
@@ -0,0 +1,461 @@
+// Host-side simulator for the scheduling policies in policy.c.
+// Builds the kernel's run queues, admission tests, stealing and
+// per-tick policy unchanged and replays a task set on them tick
+// by tick, the way trap.c and scheduler() drive them: every
+// tick each CPU picks from its queue, runs the pick for one tick
+// and puts it back.
+//
+//   schedsim [-c ncpu] [-t ticks] [-h] [-s budget/period] [taskfile]
+//   schedsim -b
+//
+// Each task line is "policy release exec [param] [p] [a=mask]
+// [g=group]": policy is edf (param is the relative deadline),
+// rms (param is the rate), stride (param is the tickets) or rr;
+// release and exec are in ticks; p makes an EDF or RMS task
+// periodic, a= sets its affinity mask and g= its process group.
+// The ran column of the report is the mask of CPUs a task ran
+// on.  -h admits RMS tasks by the hyperbolic bound instead of
+// response-time analysis, and -s reserves budget ticks per period
+// for best-effort tasks on each CPU, as sched_server() does.
+// Reports deadline misses, response times, context switches and
+// the cost of picking the next process.  -b instead times choose(), runqdel() and runqadd()
+// on one queue of 10 to 10000 processes of each policy.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sched.h"
+#include "runq.h"
+
+// In defs.h, which the simulator does not include.
+int set_server(int, int);
+
+// Kernel state and services policy.c uses.
+struct ptable ptable;
+struct cpu cpus[NCPU];
+int ncpu = 1;
+uint ticks;
+static int curcpu;
+
+struct cpu*
+mycpu(void)
+{
+  return &cpus[curcpu];
+}
+
+void
+acquire(struct spinlock *lk)
+{
+}
+
+void
+release(struct spinlock *lk)
+{
+}
+
+void
+panic(char *s)
+{
+  fprintf(stderr, "schedsim: panic: %s\n", s);
+  exit(1);
+}
+
+void
+kick(struct runq *rq, struct proc *p)
+{
+}
+
+struct task {
+  int policy;
+  int release;
+  int exec;
+  int param;
+  int periodic;
+  uint affinity;
+  int gang;
+  struct proc *p;     // 0 until released
+  int rejected;
+};
+
+static struct task *tasks;
+static int ntasks;
+static uint ran[NPROC];   // CPUs each slot's process ran on, bit i for cpu i
+
+static uint64
+nsnow(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+reset(int n)
+{
+  memset(&ptable, 0, sizeof(ptable));
+  memset(runqs, 0, sizeof(runqs));
+  memset(cpus, 0, sizeof(cpus));
+  ncpu = n;
+  ticks = 0;
+  cbsbudget = cbsperiod = 0;
+}
+
+// allocproc() and set_sched_policy() for a new process.
+static struct proc*
+newproc(int policy, int exec, int param)
+{
+  static int nextpid = 1;
+  struct proc *p;
+
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state == UNUSED)
+      break;
+  if(p == &ptable.proc[NPROC])
+    panic("too many tasks");
+  memset(p, 0, sizeof(*p));
+  p->pid = nextpid++;
+  p->sched_policy = policy;
+  p->exec_time = exec;
+  if(policy == SCHED_EDF)
+    p->deadline = param;
+  if(policy == SCHED_RMS)
+    p->rate = param;
+  p->rmsprio = rmsprio(p->rate);
+  p->arrival_time = ticks;
+  p->firstrelease = ticks;
+  p->njobs = 1;
+  p->affinity = ~0;
+  p->rtcpu = -1;
+  p->util = -1;
+  p->ipolicy = SCHED_DEFAULT;
+  p->iprio = NRMSPRIO;
+  p->heapidx = -1;
+  p->quantum = mlfqquantum(0);
+  p->tickets = policy == SCHED_STRIDE ? param : NTICKETS;
+  p->stride = STRIDE1 / p->tickets;
+  p->state = RUNNABLE;
+  return p;
+}
+
+static void
+release_task(struct task *t, int test)
+{
+  struct proc *p;
+
+  p = newproc(t->policy, t->exec, t->param);
+  p->periodic = t->periodic;
+  p->affinity = t->affinity;
+  p->gang = t->gang;
+  ran[p - ptable.proc] = 0;
+  runqadd(&runqs[p->pid % ncpu], p, 0);
+  if(SCHED_RT(p->sched_policy) && admit(p, test) < 0){
+    runqdel(p);
+    p->state = UNUSED;
+    t->rejected = 1;
+    return;
+  }
+  t->p = p;
+}
+
+// The current job of p has used up its budget, as in trap.c,
+// or a best-effort process has finished.  Only real-time jobs
+// count in the totals.
+static void
+complete(struct proc *p)
+{
+  int resp;
+
+  if(!SCHED_RT(p->sched_policy)){
+    resp = ticks - p->arrival_time;
+    p->jobsdone++;
+    if(resp > p->maxresp)
+      p->maxresp = resp;
+    p->state = ZOMBIE;
+    return;
+  }
+  jobend(p);
+  if(p->periodic){
+    jobnext(p);
+    p->state = SLEEPING;
+    return;
+  }
+  rtleave(p);
+  p->state = ZOMBIE;
+}
+
+// An idle CPU takes a best-effort process from a peer.
+static struct proc*
+steal(int cpu)
+{
+  struct runq *from = stealfrom(cpu);
+
+  return from ? stealable(from, cpu) : 0;
+}
+
+static int
+simulate(int maxticks, int test)
+{
+  struct proc *run[NCPU], *last[NCPU], *p;
+  struct runq *q;
+  struct task *t;
+  uint64 picks, pickns, t0;
+  int c, i, live, switches;
+
+  picks = pickns = 0;
+  switches = 0;
+  memset(last, 0, sizeof(last));
+  for(ticks = 0; ticks < maxticks; ){
+    live = 0;
+    for(i = 0; i < ntasks; i++){
+      t = &tasks[i];
+      if(t->p == 0 && !t->rejected && t->release == ticks)
+        release_task(t, test);
+      p = t->p;
+      if(p && p->state == SLEEPING && (int)ticks >= p->arrival_time){
+        p->state = RUNNABLE;
+        runqadd(&runqs[p->pid % ncpu], p, 0);
+      }
+      if((p && p->state != ZOMBIE) || (p == 0 && !t->rejected))
+        live++;
+    }
+    if(live == 0)
+      break;
+
+    // Every CPU picks before any process is put back.
+    for(c = 0; c < ncpu; c++){
+      curcpu = c;
+      cpus[c].server = 0;
+      t0 = nsnow();
+      p = runqs[c].nready ? choose(&runqs[c]) : steal(c);
+      pickns += nsnow() - t0;
+      picks++;
+      run[c] = p;
+      cpus[c].proc = p;
+      if(p == 0)
+        continue;
+      ran[p - ptable.proc] |= 1 << c;
+      q = runqdel(p);
+      if(p->sched_policy == SCHED_STRIDE){
+        q->vtime = p->pass;
+        p->pass += p->stride;
+      }
+      p->state = RUNNING;
+      misscheck(p);
+      if(p != last[c])
+        switches++;
+      last[c] = p;
+    }
+
+    // Run each pick for one tick, then take the timer
+    // interrupt as trap.c does.
+    ticks++;
+    for(c = 0; c < ncpu; c++){
+      curcpu = c;
+      if((p = run[c]) == 0)
+        continue;
+      p->elapsed_time++;
+      misscheck(p);
+      queuemisses(&runqs[c]);
+      if(cpus[c].server)
+        cbscharge(cpus[c].server);
+      mlfqcharge(p);
+    }
+    mlfqboost();
+    gangrotate();
+    for(c = 0; c < ncpu; c++){
+      curcpu = c;
+      cpus[c].proc = 0;
+      if((p = run[c]) == 0)
+        continue;
+      if(p->elapsed_time >= p->exec_time){
+        complete(p);
+        if(p->state == SLEEPING && (int)ticks >= p->arrival_time){
+          p->state = RUNNABLE;
+          runqadd(&runqs[c], p, 0);
+        }
+        continue;
+      }
+      p->state = RUNNABLE;
+      runqadd(&runqs[c], p, 1);
+    }
+  }
+
+  printf("task policy release cpu jobs misses maxresp ran\n");
+  for(i = 0; i < ntasks; i++){
+    t = &tasks[i];
+    if(t->rejected || t->p == 0){
+      printf("%4d %6d %7d %s\n", i, t->policy, t->release,
+             t->rejected ? "rejected" : "not released");
+      continue;
+    }
+    p = t->p;
+    printf("%4d %6d %7d %3d %4d %6d %7d %3x\n", i, t->policy, t->release,
+           p->rtcpu, p->jobsdone, p->nmisses, p->maxresp, ran[p - ptable.proc]);
+  }
+  printf("ticks %d jobs %d misses %d maxresp %d switches %d\n",
+         ticks, ptable.stats.jobs, ptable.stats.misses,
+         ptable.stats.maxresp, switches);
+  if(picks)
+    printf("pick-next %llu ns avg over %llu picks\n", pickns / picks, picks);
+  return 0;
+}
+
+static int
+parsepolicy(char *s)
+{
+  if(strcmp(s, "edf") == 0)
+    return SCHED_EDF;
+  if(strcmp(s, "rms") == 0)
+    return SCHED_RMS;
+  if(strcmp(s, "stride") == 0)
+    return SCHED_STRIDE;
+  if(strcmp(s, "rr") == 0)
+    return SCHED_DEFAULT;
+  return -2;
+}
+
+static void
+readtasks(FILE *f)
+{
+  char line[256], copy[256], *tok;
+  struct task *t;
+  int n, bad, cap = 0;
+
+  while(fgets(line, sizeof(line), f)){
+    if(line[0] == '#' || line[0] == '\n')
+      continue;
+    if(ntasks == cap){
+      cap = cap ? 2*cap : 64;
+      tasks = realloc(tasks, cap*sizeof(tasks[0]));
+    }
+    t = &tasks[ntasks];
+    memset(t, 0, sizeof(*t));
+    t->affinity = ~0;
+    strcpy(copy, line);
+    n = 0;
+    bad = 0;
+    for(tok = strtok(copy, " \t\n"); tok; tok = strtok(0, " \t\n"), n++){
+      if(n == 0)
+        t->policy = parsepolicy(tok);
+      else if(n == 1)
+        t->release = atoi(tok);
+      else if(n == 2)
+        t->exec = atoi(tok);
+      else if(strcmp(tok, "p") == 0)
+        t->periodic = SCHED_RT(t->policy);
+      else if(strncmp(tok, "a=", 2) == 0)
+        t->affinity = strtoul(tok + 2, 0, 0);
+      else if(strncmp(tok, "g=", 2) == 0)
+        t->gang = atoi(tok + 2);
+      else if(n == 3)
+        t->param = atoi(tok);
+      else
+        bad = 1;
+    }
+    if(bad || n < 3 || t->policy == -2 || t->exec <= 0 || t->release < 0 ||
+       (t->policy != SCHED_DEFAULT && t->param <= 0) ||
+       (t->affinity & ((1u << NCPU) - 1)) == 0 || t->gang < 0){
+      fprintf(stderr, "schedsim: bad task: %s", line);
+      exit(1);
+    }
+    ntasks++;
+  }
+}
+
+// Time one pick-next cycle, choose() then runqdel() then
+// runqadd(), on a single queue of n processes.  EDF and stride
+// processes get a later deadline or pass each time, so the
+// heaps are reordered as they would be.
+static void
+bench(int policy, int n)
+{
+  struct runq *rq = &runqs[0];
+  struct proc *p;
+  uint64 t0, ns;
+  int i, iters;
+
+  reset(1);
+  for(i = 0; i < n; i++){
+    p = newproc(policy, 1, policy == SCHED_RMS ? 1 + i%30 : 1 + i%97);
+    p->arrival_time = i;
+    runqadd(rq, p, 0);
+  }
+  iters = 1000000;
+  t0 = nsnow();
+  for(i = 0; i < iters; i++){
+    p = choose(rq);
+    runqdel(p);
+    if(policy == SCHED_EDF)
+      p->arrival_time += p->deadline;
+    if(policy == SCHED_STRIDE){
+      rq->vtime = p->pass;
+      p->pass += p->stride;
+    }
+    runqadd(rq, p, 0);
+  }
+  ns = nsnow() - t0;
+  ns = ns * 10 / iters;
+  printf("%-6s %6d %6llu.%llu\n", policy == SCHED_EDF ? "edf" :
+         policy == SCHED_RMS ? "rms" : policy == SCHED_STRIDE ? "stride" : "rr",
+         n, ns / 10, ns % 10);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static int sizes[] = { 10, 100, 1000, 10000 };
+  static int policies[] = { SCHED_EDF, SCHED_RMS, SCHED_STRIDE, SCHED_DEFAULT };
+  int i, j, n, maxticks, test, budget, period;
+  FILE *f;
+
+  n = 1;
+  maxticks = 1000;
+  test = SCHED_RTA;
+  budget = period = 0;
+  for(i = 1; i < argc && argv[i][0] == '-'; i++){
+    if(strcmp(argv[i], "-b") == 0){
+      printf("policy  tasks  ns/pick\n");
+      for(j = 0; j < 4; j++)
+        for(n = 0; n < 4; n++)
+          bench(policies[j], sizes[n]);
+      return 0;
+    } else if(strcmp(argv[i], "-h") == 0)
+      test = SCHED_HB;
+    else if(strcmp(argv[i], "-c") == 0 && i+1 < argc)
+      n = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-t") == 0 && i+1 < argc)
+      maxticks = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-s") == 0 && i+1 < argc &&
+            sscanf(argv[++i], "%d/%d", &budget, &period) == 2)
+      ;
+    else {
+      fprintf(stderr, "usage: schedsim [-c ncpu] [-t ticks] [-h] [-s budget/period] [taskfile]\n"
+                      "       schedsim -b\n");
+      return 1;
+    }
+  }
+  if(n < 1 || n > NCPU){
+    fprintf(stderr, "schedsim: 1 to %d cpus\n", NCPU);
+    return 1;
+  }
+  f = stdin;
+  if(i < argc && (f = fopen(argv[i], "r")) == 0){
+    perror(argv[i]);
+    return 1;
+  }
+  readtasks(f);
+  reset(n);
+  if(budget && set_server(budget, period) < 0){
+    fprintf(stderr, "schedsim: bad server %d/%d\n", budget, period);
+    return 1;
+  }
+  return simulate(maxticks, test);
+}
@@ -0,0 +1,39 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "sched.h"
+
+// Print real-time statistics for each pid given, or the
+// system-wide totals with no arguments.
+void
+show(int pid)
+{
+  struct schedstats st;
+
+  if(sched_stats(pid, &st) < 0){
+    printf(2, "schedstat: no process %d\n", pid);
+    return;
+  }
+  if(pid == 0)
+    printf(1, "all:");
+  else
+    printf(1, "%d:", pid);
+  printf(1, " jobs %d misses %d late max %d sum %d resp max %d sum %d preempts %d\n",
+         st.jobs, st.misses, st.maxlate, st.totlate, st.maxresp, st.totresp,
+         st.preempts);
+  // In units of 2^20 cycles; user programs have no 64-bit divide.
+  printf(1, "  Mcycles user %d kernel %d wait %d\n",
+         (int)(st.ucycles >> 20), (int)(st.kcycles >> 20), (int)(st.wcycles >> 20));
+}
+
+int
+main(int argc, char **argv)
+{
+  int i;
+
+  if(argc < 2)
+    show(0);
+  for(i=1; i<argc; i++)
+    show(atoi(argv[i]));
+  exit();
+}
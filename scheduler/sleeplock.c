@@ -16,18 +16,32 @@ initsleeplock(struct sleeplock *lk, char *name)
   initlock(&lk->lk, "sleep lock");
   lk->name = name;
   lk->locked = 0;
+  lk->nwaiters = 0;
   lk->pid = 0;
+  lk->owner = 0;
 }
 
+// Priority inheritance, lockowner() and wakeup() all take
+// ptable.lock, so they are skipped while nobody waits: the
+// owner can only inherit through lk from its waiters, and a
+// waiter is counted under lk->lk before it sleeps.
+
 void
 acquiresleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
   while (lk->locked) {
+    lk->nwaiters++;
+    lockwait(lk);
     sleep(lk, &lk->lk);
+    lk->nwaiters--;
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  if(lk->nwaiters || myproc()->waitlock)
+    lockowner(lk, myproc());
+  else
+    lk->owner = myproc();
   release(&lk->lk);
 }
 
@@ -37,7 +51,11 @@ releasesleep(struct sleeplock *lk)
   acquire(&lk->lk);
   lk->locked = 0;
   lk->pid = 0;
-  wakeup(lk);
+  if(lk->nwaiters){
+    lockowner(lk, 0);
+    wakeup(lk);
+  } else
+    lk->owner = 0;
   release(&lk->lk);
 }
 
@@ -1,10 +1,12 @@
 // Long-term locks for processes
 struct sleeplock {
   uint locked;       // Is the lock held?
+  int nwaiters;      // Processes sleeping in acquiresleep()
   struct spinlock lk; // spinlock protecting this sleep lock
   
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+  struct proc *owner; // Process holding lock, for priority inheritance
 };
 
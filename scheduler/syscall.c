@@ -107,6 +107,17 @@ extern int sys_sched_policy(void);
 extern int sys_exec_time(void);
 extern int sys_deadline(void);
 extern int sys_rate(void);
+extern int sys_schedtrace(void);
+extern int sys_sched_stats(void);
+extern int sys_sched_server(void);
+extern int sys_cpustat(void);
+extern int sys_tickets(void);
+extern int sys_sched_setattr(void);
+extern int sys_sched_setattrs(void);
+extern int sys_sched_setaffinity(void);
+extern int sys_sched_getaffinity(void);
+extern int sys_sched_gang(void);
+extern int sys_nsec(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -134,6 +145,17 @@ static int (*syscalls[])(void) = {
 [SYS_exec_time]   sys_exec_time,
 [SYS_deadline]   sys_deadline,
 [SYS_rate]   sys_rate,
+[SYS_schedtrace]   sys_schedtrace,
+[SYS_sched_stats]   sys_sched_stats,
+[SYS_sched_server]   sys_sched_server,
+[SYS_cpustat]   sys_cpustat,
+[SYS_tickets]   sys_tickets,
+[SYS_sched_setattr]   sys_sched_setattr,
+[SYS_sched_setattrs]   sys_sched_setattrs,
+[SYS_sched_setaffinity]   sys_sched_setaffinity,
+[SYS_sched_getaffinity]   sys_sched_getaffinity,
+[SYS_sched_gang]   sys_sched_gang,
+[SYS_nsec]   sys_nsec,
 };
 
 void
@@ -24,3 +24,14 @@
 #define SYS_exec_time  23
 #define SYS_deadline  24
 #define SYS_rate  25
+#define SYS_schedtrace  26
+#define SYS_sched_stats  27
+#define SYS_sched_server  28
+#define SYS_cpustat  29
+#define SYS_tickets  30
+#define SYS_sched_setattr  31
+#define SYS_sched_setattrs  32
+#define SYS_sched_setaffinity  33
+#define SYS_sched_getaffinity  34
+#define SYS_sched_gang  35
+#define SYS_nsec  36
@@ -6,6 +6,7 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "sched.h"
 
 int
 sys_fork(void)
@@ -59,22 +60,14 @@ sys_sbrk(void)
 int
 sys_sleep(void)
 {
-  int n;
-  uint ticks0;
+  int n, r;
 
   if(argint(0, &n) < 0)
     return -1;
   acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(myproc()->killed){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
-  }
+  r = sleepuntil(ticks + n);
   release(&tickslock);
-  return 0;
+  return r;
 }
 
 // return how many clock tick interrupts have occurred
@@ -94,26 +87,24 @@ sys_uptime(void)
 int
 sys_sched_policy(int pid, int policy)
 {
+  int flags;
+
   if (argint(0, &pid) < 0 || argint(1, &policy)<0) return -22;
-  int check_if_pid_present= set_sched_policy(pid, policy);
+  flags = 0;
+  if (policy >= 0){
+    flags = policy & SCHED_FLAGS;
+    policy &= ~SCHED_FLAGS;
+  }
+  int check_if_pid_present= set_sched_policy(pid, policy, flags);
   if(check_if_pid_present==-22) return -22;
 
-  if (policy==0){ //EDF
-    int schedulable = is_edf_schedulable(pid);
-    //cprintf("Got Schedulability %d\n", schedulable);
-    if (schedulable == -22){
-        //cprintf("Killing process %d as it is not schedulable\n", pid);
-        kill(pid);
-      }
-    return schedulable;
-  }else if(policy==1){ //RMS
-    int schedulable = is_rms_schedulable(pid);
-    //cprintf("Got Schedulability %d\n", schedulable);
-    if (schedulable == -22){
-        //cprintf("Killing process %d as it is not schedulable\n", pid);
-        kill(pid);
-      }
-    return schedulable;
+  // A task that is not schedulable is killed.
+  if (policy==SCHED_EDF){
+    return is_edf_schedulable(pid);
+  }else if(policy==SCHED_RMS){
+    return is_rms_schedulable(pid, flags & SCHED_TESTMASK);
+  }else if(policy==SCHED_STRIDE){
+    return 0;
   }else{
     return -22;
   }
@@ -141,4 +132,148 @@ sys_deadline(int pid, int deadline)
   if (argint(0, &pid) < 0 || argint(1, &deadline) < 0) return -22;
   return set_deadline(pid, deadline);
   
-}
\ No newline at end of file
+}
+
+// Copy up to n scheduler trace events into the user buffer.
+// No more than the rings hold can be returned, so larger n are
+// cut down before the size is checked.
+int
+sys_schedtrace(void)
+{
+  struct schedevent *buf;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -22;
+  if(n > ncpu*NTRACE)
+    n = ncpu*NTRACE;
+  if(argptr(0, (void*)&buf, n*sizeof(*buf)) < 0)
+    return -22;
+  return traceread(buf, n);
+}
+
+// Real-time statistics of pid, or system-wide for pid 0.
+int
+sys_sched_stats(void)
+{
+  struct schedstats *st;
+  int pid;
+
+  if(argint(0, &pid) < 0 || argptr(1, (void*)&st, sizeof(*st)) < 0)
+    return -22;
+  return getstats(pid, st);
+}
+
+// Reserve budget ticks per period for best-effort processes.
+int
+sys_sched_server(void)
+{
+  int budget, period;
+
+  if(argint(0, &budget) < 0 || argint(1, &period) < 0)
+    return -22;
+  return set_server(budget, period);
+}
+
+// Idle time of each CPU, for at most n of them.
+int
+sys_cpustat(void)
+{
+  struct cpustat *st;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -22;
+  if(n > ncpu)
+    n = ncpu;
+  if(argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -22;
+  return getcpustat(st, n);
+}
+
+// Stride tickets for pid.
+int
+sys_tickets(void)
+{
+  int pid, n;
+
+  if(argint(0, &pid) < 0 || argint(1, &n) < 0)
+    return -22;
+  return set_tickets(pid, n);
+}
+
+// Set every scheduling parameter of pid and run the admission
+// test in one step.
+int
+sys_sched_setattr(void)
+{
+  struct sched_attr *a;
+  int pid;
+
+  if(argint(0, &pid) < 0 || argptr(1, (void*)&a, sizeof(*a)) < 0)
+    return -22;
+  return sched_setattr(pid, a);
+}
+
+// sched_setattr() for n processes at once.  Returns how many
+// were configured before the first failure.
+int
+sys_sched_setattrs(void)
+{
+  struct sched_attr *a;
+  int *pids, n;
+
+  if(argint(2, &n) < 0 || n < 0 || n > NPROC)
+    return -22;
+  if(argptr(0, (void*)&pids, n*sizeof(*pids)) < 0 ||
+     argptr(1, (void*)&a, n*sizeof(*a)) < 0)
+    return -22;
+  return sched_setattrs(pids, a, n);
+}
+
+// Restrict pid to the CPUs in a bit mask.
+int
+sys_sched_setaffinity(void)
+{
+  int pid, mask;
+
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+    return -22;
+  return set_affinity(pid, mask);
+}
+
+// The CPUs pid may run on, as a bit mask.
+int
+sys_sched_getaffinity(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -22;
+  return get_affinity(pid);
+}
+
+// Put pid in a gang-scheduled process group, or in none.
+int
+sys_sched_gang(void)
+{
+  int pid, gang;
+
+  if(argint(0, &pid) < 0 || argint(1, &gang) < 0)
+    return -22;
+  return set_gang(pid, gang);
+}
+
+// Nanoseconds since boot, from the TSC.  Fails if the TSC was
+// not calibrated.
+int
+sys_nsec(void)
+{
+  uint64 *t;
+
+  if(argptr(0, (void*)&t, sizeof(*t)) < 0)
+    return -22;
+  if((*t = nsec()) == 0)
+    return -22;
+  return 0;
+}
@@ -0,0 +1,84 @@
+// Drain the scheduler trace and print it as a timeline:
+// one line per run of a process on a CPU, plus releases,
+// completions, deadline misses and rejections, in time order.
+// Times are in ticks and in units of 1024 TSC cycles since the
+// first event.  Completion lines end in "<arrival> <pid>", like
+// the console messages check_schedulability.py reads.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "sched.h"
+
+#define NEV 2048
+
+struct schedevent ev[NEV];
+struct schedevent *running[NCPU];
+
+// Insertion sort by TSC; each CPU's events are already in order.
+void
+sortev(int n)
+{
+  struct schedevent e;
+  int i, j;
+
+  for(i = 1; i < n; i++){
+    e = ev[i];
+    for(j = i; j > 0 && ev[j-1].tsc > e.tsc; j--)
+      ev[j] = ev[j-1];
+    ev[j] = e;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedevent *e, *s;
+  uint64 base;
+  int i, n, k;
+
+  n = 0;
+  while(n < NEV && (k = schedtrace(ev + n, NEV - n)) > 0)
+    n += k;
+  if(k < 0){
+    printf(2, "timeline: kernel built without TRACE=1\n");
+    exit();
+  }
+  if(n == 0)
+    exit();
+  sortev(n);
+
+  base = ev[0].tsc;
+  for(i = 0; i < n; i++){
+    e = &ev[i];
+    switch(e->type){
+    case TR_SWITCHIN:
+      if(e->cpu < NCPU)
+        running[e->cpu] = e;
+      break;
+    case TR_SWITCHOUT:
+      s = e->cpu < NCPU ? running[e->cpu] : 0;
+      if(s == 0 || s->pid != e->pid)
+        break;
+      printf(1, "cpu%d %d-%d ticks %d-%d: run pid %d\n", e->cpu,
+             (int)((s->tsc - base) >> 10), (int)((e->tsc - base) >> 10),
+             s->tick, e->tick, e->pid);
+      running[e->cpu] = 0;
+      break;
+    case TR_RELEASE:
+      printf(1, "tick %d: release pid %d at %d\n", e->tick, e->pid, e->arg);
+      break;
+    case TR_COMPLETE:
+      printf(1, "tick %d: the completed process: %d %d\n", e->tick, e->arg, e->pid);
+      break;
+    case TR_MISS:
+      printf(1, "tick %d: pid %d missed deadline %d\n", e->tick, e->pid, e->arg);
+      break;
+    case TR_REJECT:
+      printf(1, "tick %d: pid %d rejected\n", e->tick, e->pid);
+      break;
+    }
+  }
+  exit();
+}
@@ -0,0 +1,397 @@
+// Timekeeping.
+// The TSC is the clock.  The local APIC timer runs in one-shot
+// mode and each CPU programs it for its own next event, so an
+// idle CPU is not interrupted every tick.  Both are calibrated
+// against channel 2 of the 8253/8254 PIT at boot.
+//
+// Timeouts, including every sleep(n), are kept on a hierarchical
+// timer wheel and each fires exactly once.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "timer.h"
+
+#define IO_TIMER1       0x040           // 8253 Timer #1
+#define TIMER_CNTR2     (IO_TIMER1 + 2) // timer 2 counter port
+#define TIMER_MODE      (IO_TIMER1 + 3) // timer mode port
+#define   TIMER_SEL2    0x80            // select counter 2
+#define   TIMER_16BIT   0x30            // r/w counter 16 bits, LSB first
+#define   TIMER_INTTC   0x00            // mode 0, output high on count 0
+#define IO_PPI          0x061           // keyboard controller port B
+#define   PPI_GATE2     0x01            // timer 2 gate
+#define   PPI_SPKR      0x02            // speaker enable
+#define   PPI_OUT2      0x20            // timer 2 output
+
+#define TIMER_FREQ      1193182
+#define CALTICKS        5               // calibrate over 5 ticks
+
+static uint64 tscboot;  // TSC when ticks was 0
+static uint tsctick;    // TSC cycles per tick, 0 if not calibrated
+static uint nsmult;     // ns per TSC cycle, 8.24 fixed point
+static uint lapicmult;  // APIC timer counts per TSC cycle, 8.24
+
+// The wheel has NWHEEL levels of WHEELSIZE slots.  Level l holds
+// timers due within WHEELSIZE^(l+1) ticks of wheeltick, in slots
+// WHEELSIZE^l ticks wide.  Each time level l-1 wraps, the next
+// slot of level l is cascaded down.  All under tickslock.
+#define WHEELBITS   6
+#define WHEELSIZE   (1 << WHEELBITS)
+#define WHEELMASK   (WHEELSIZE - 1)
+#define NWHEEL      4
+#define WHEELSPAN   (1u << (WHEELBITS*NWHEEL))
+
+static struct ktimer *wheel[NWHEEL][WHEELSIZE];
+static uint wheeltick;  // next tick whose timers have not fired
+static int ntimers;     // timers pending
+static uint wakeat;     // no pending timer is due before this
+
+// Divide n by d.  The quotient must fit in 32 bits.
+static uint
+div64(uint64 n, uint d)
+{
+  uint q, r;
+
+  asm("divl %4" : "=a" (q), "=d" (r) : "a" ((uint)n), "d" ((uint)(n >> 32)), "rm" (d));
+  return q;
+}
+
+// Multiply n by the 8.24 fixed-point fraction m.
+static uint64
+mulfrac(uint64 n, uint m)
+{
+  return ((uint64)(uint)n * m >> 24) + ((uint64)(uint)(n >> 32) * m << 8);
+}
+
+// Measure the TSC and the APIC timer against the PIT, then
+// switch the APIC timer to one-shot mode.  If the PIT does not
+// count, leave the APIC timer periodic.
+void
+timerinit(void)
+{
+  uint64 t0, t1;
+  uint n, count, i;
+
+  if(!lapic)
+    return;
+
+  count = TIMER_FREQ * CALTICKS / HZ;
+  outb(IO_PPI, (inb(IO_PPI) & ~PPI_SPKR) | PPI_GATE2);
+  outb(TIMER_MODE, TIMER_SEL2 | TIMER_16BIT | TIMER_INTTC);
+  lapictimermode(1);
+  lapictimer(~0);
+  outb(TIMER_CNTR2, count & 0xFF);
+  outb(TIMER_CNTR2, count >> 8);
+  t0 = rdtsc();
+  for(i = 0; i < 10000000; i++)
+    if(inb(IO_PPI) & PPI_OUT2)
+      break;
+  t1 = rdtsc();
+  n = ~0 - lapictimercount();
+  lapictimer(0);
+
+  if(i == 10000000 || t1 - t0 < CALTICKS || (t1 - t0) >> 32){
+    cprintf("timer: PIT calibration failed, using periodic ticks\n");
+    lapictimermode(0);
+    return;
+  }
+  tscboot = t1;
+  tsctick = (uint)(t1 - t0) / CALTICKS;
+  nsmult = div64((uint64)(1000000000 / HZ) << 24, tsctick);
+  lapicmult = div64((uint64)(n / CALTICKS) << 24, tsctick);
+}
+
+// TSC cycles since boot.  An AP's TSC may lag the boot CPU's
+// slightly; count that as no time rather than a wrapped one.
+static uint64
+sinceboot(void)
+{
+  uint64 t = rdtsc();
+
+  return t > tscboot ? t - tscboot : 0;
+}
+
+// Nanoseconds since boot, or 0 if the TSC is not calibrated.
+uint64
+nsec(void)
+{
+  if(tsctick == 0)
+    return 0;
+  return mulfrac(sinceboot(), nsmult);
+}
+
+// TSC cycles in n ticks, or 0 if the TSC is not calibrated.
+uint64
+ticks2cycles(uint n)
+{
+  return (uint64)n * tsctick;
+}
+
+// TSC time at which tick t starts.
+static uint64
+tickstart(uint t)
+{
+  return tscboot + (uint64)t * tsctick;
+}
+
+// Program this CPU's APIC timer to fire at TSC time t, unless it
+// is already due to fire sooner.  Interrupts must be off.
+static void
+timerset(struct cpu *c, uint64 t)
+{
+  uint64 now, n;
+
+  if(c->timerat && c->timerat <= t)
+    return;
+  now = rdtsc();
+  n = t > now ? t - now : 1;
+  if(n >> 32)
+    n = 0xFFFFFFFF;
+  n = mulfrac(n, lapicmult);
+  if(n == 0)
+    n = 1;
+  if(n >> 32)
+    n = 0xFFFFFFFF;
+  lapictimer((uint)n);
+  c->timerat = t;
+}
+
+// Also interrupt this CPU at TSC time t.  Interrupts must be
+// off.
+void
+timeralarm(uint64 t)
+{
+  if(tsctick)
+    timerset(mycpu(), t);
+}
+
+static void
+wheeladd(struct ktimer *t)
+{
+  struct ktimer **slot;
+  uint when, d;
+  int l;
+
+  when = t->expire;
+  d = when - wheeltick;
+  if((int)d < 0){
+    // Overdue: fire on the next tick processed.
+    when = wheeltick;
+    d = 0;
+  }
+  if(d >= WHEELSPAN){
+    // Too far out: park in the last slot; cascading re-adds it.
+    d = WHEELSPAN - 1;
+    when = wheeltick + d;
+  }
+  for(l = 0; l < NWHEEL-1 && d >= 1u << (WHEELBITS*(l+1)); l++)
+    ;
+  slot = &wheel[l][(when >> (WHEELBITS*l)) & WHEELMASK];
+  t->next = *slot;
+  if(t->next)
+    t->next->pprev = &t->next;
+  t->pprev = slot;
+  *slot = t;
+}
+
+// Re-add the timers in a slot now that they are closer.
+static void
+cascade(int l, int i)
+{
+  struct ktimer *t, *next;
+
+  t = wheel[l][i];
+  wheel[l][i] = 0;
+  for(; t; t = next){
+    next = t->next;
+    wheeladd(t);
+  }
+}
+
+// Earliest tick a pending timer could be due: the first busy
+// slot at each level, by the start of its span.
+static uint
+nextexpiry(void)
+{
+  uint best, s;
+  int l, i, found;
+
+  best = wheeltick + WHEELSPAN;
+  found = 0;
+  for(l = 0; l < NWHEEL; l++){
+    for(i = 0; i < WHEELSIZE; i++){
+      s = (wheeltick >> (WHEELBITS*l)) + i;
+      if(wheel[l][s & WHEELMASK] == 0)
+        continue;
+      s <<= WHEELBITS*l;
+      if((int)(s - wheeltick) < 0)
+        s = wheeltick;
+      if(!found || (int)(s - best) < 0)
+        best = s;
+      found = 1;
+      break;
+    }
+  }
+  return best;
+}
+
+// Fire every timer due by ticks.
+static void
+wheelrun(void)
+{
+  struct ktimer *t;
+  int l;
+
+  if(ntimers == 0){
+    wheeltick = ticks + 1;
+    return;
+  }
+  if((int)(ticks - wakeat) < 0)
+    return;
+  while((int)(ticks - wheeltick) >= 0 && ntimers > 0){
+    for(l = 1; l < NWHEEL &&
+        ((wheeltick >> (WHEELBITS*(l-1))) & WHEELMASK) == 0; l++)
+      cascade(l, (wheeltick >> (WHEELBITS*l)) & WHEELMASK);
+    while((t = wheel[0][wheeltick & WHEELMASK]) != 0){
+      timerdel(t);
+      t->fn(t->arg);
+    }
+    wheeltick++;
+  }
+  if(ntimers == 0)
+    wheeltick = ticks + 1;
+  else
+    wakeat = nextexpiry();
+}
+
+// Call fn(arg) once ticks reaches expire, unless timerdel(t)
+// comes first.  t must not be pending.  Caller holds tickslock.
+void
+timeradd(struct ktimer *t, uint expire, void (*fn)(void*), void *arg)
+{
+  if(t->pprev)
+    panic("timeradd");
+  t->expire = expire;
+  t->fn = fn;
+  t->arg = arg;
+  wheeladd(t);
+  if(ntimers++ == 0 || (int)(expire - wakeat) < 0)
+    wakeat = expire;
+}
+
+// Cancel t.  Returns 1 if it was pending.  Caller holds
+// tickslock.
+int
+timerdel(struct ktimer *t)
+{
+  if(t->pprev == 0)
+    return 0;
+  *t->pprev = t->next;
+  if(t->next)
+    t->next->pprev = t->pprev;
+  t->pprev = 0;
+  ntimers--;
+  return 1;
+}
+
+static void
+timerwake(void *chan)
+{
+  wakeup(chan);
+}
+
+// Sleep until ticks reaches t.  Caller holds tickslock.
+// Returns -1 if the process was killed first.
+int
+sleepuntil(uint t)
+{
+  struct ktimer k;
+
+  k.pprev = 0;
+  while((int)(ticks - t) < 0){
+    if(myproc()->killed)
+      return -1;
+    timeradd(&k, t, timerwake, &k);
+    sleep(&k, &tickslock);
+    timerdel(&k);
+  }
+  return 0;
+}
+
+// Bring ticks up to date with the TSC and fire the timers whose
+// time has come.
+static void
+clockupdate(void)
+{
+  uint t;
+
+  acquire(&tickslock);
+  t = div64(sinceboot(), tsctick);
+  if((int)(t - ticks) > 0){
+    ticks = t;
+    wheelrun();
+  }
+  release(&tickslock);
+}
+
+// Timer interrupt on this CPU.  A CPU running a process is
+// armed for the next tick boundary, since quanta and budgets are
+// counted in ticks; an idle CPU only for the earliest sleeper.
+// Returns 1 if a tick has started since this CPU's last timer
+// interrupt.
+int
+timerintr(void)
+{
+  struct cpu *c = mycpu();
+  int newtick;
+
+  if(tsctick == 0){
+    // Periodic fallback: CPU 0 keeps time.
+    if(cpuid() == 0){
+      acquire(&tickslock);
+      ticks++;
+      wheelrun();
+      release(&tickslock);
+    }
+    return 1;
+  }
+
+  clockupdate();
+  newtick = ticks != c->lasttick;
+  c->lasttick = ticks;
+  c->timerat = 0;
+  if(c->proc)
+    timerset(c, tickstart(ticks + 1));
+  else if(ntimers)
+    timerset(c, tickstart(wakeat));
+  return newtick;
+}
+
+// This CPU is about to run processes.  Make sure its timer will
+// fire at the next tick boundary; if it was idle, ticks may be
+// stale, so catch up first.  Must not hold ptable.lock.
+void
+timerbusy(void)
+{
+  struct cpu *c;
+  int idle;
+
+  if(tsctick == 0)
+    return;
+  pushcli();
+  c = mycpu();
+  idle = c->timerat == 0 || c->timerat > tickstart(ticks + 1);
+  popcli();
+  if(!idle)
+    return;
+  clockupdate();
+  pushcli();
+  c = mycpu();
+  c->lasttick = ticks;
+  timerset(c, tickstart(ticks + 1));
+  popcli();
+}
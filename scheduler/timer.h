@@ -0,0 +1,10 @@
+// Kernel timeouts.  A pending timer sits in a slot of the timer
+// wheel in timer.c until ticks reaches expire; then fn(arg) is
+// called, once, with tickslock held.  See timeradd().
+struct ktimer {
+  uint expire;              // tick to fire at
+  void (*fn)(void*);
+  void *arg;
+  struct ktimer *next;      // in its wheel slot
+  struct ktimer **pprev;    // link pointing at this timer, 0 if not pending
+};
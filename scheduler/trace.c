@@ -0,0 +1,93 @@
+// Scheduler event trace.
+// Each CPU logs into its own ring without locks: only that CPU
+// advances head, with interrupts off, and only readers advance
+// tail.  When a ring is full new events are dropped.  Built only
+// with -DSCHEDTRACE (make TRACE=1); otherwise TRACE() compiles
+// to nothing and schedtrace() fails.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "sched.h"
+
+#ifdef SCHEDTRACE
+
+static struct {
+  struct schedevent ev[NTRACE];
+  volatile uint head;
+  volatile uint tail;
+  uint dropped;
+} rings[NCPU];
+
+static struct spinlock readlock;  // serialises readers
+
+void
+traceinit(void)
+{
+  initlock(&readlock, "trace");
+}
+
+// Record an event.  Interrupts must be off.
+void
+tracelog(int type, int pid, int arg)
+{
+  int cpu = cpuid();
+  struct schedevent *e;
+  uint h = rings[cpu].head;
+
+  if(h - rings[cpu].tail >= NTRACE){
+    rings[cpu].dropped++;
+    return;
+  }
+  e = &rings[cpu].ev[h & (NTRACE-1)];
+  e->tsc = rdtsc();
+  e->tick = ticks;
+  e->type = type;
+  e->cpu = cpu;
+  e->pid = pid;
+  e->arg = arg;
+  __sync_synchronize();
+  rings[cpu].head = h + 1;
+}
+
+// Copy up to n pending events into buf, ring by ring, and
+// return how many.  Events from different CPUs are not merged;
+// sort by tsc.
+int
+traceread(struct schedevent *buf, int n)
+{
+  int cpu, k;
+  uint h, t;
+
+  acquire(&readlock);
+  k = 0;
+  for(cpu = 0; cpu < ncpu && k < n; cpu++){
+    h = rings[cpu].head;
+    __sync_synchronize();
+    for(t = rings[cpu].tail; t != h && k < n; t++)
+      buf[k++] = rings[cpu].ev[t & (NTRACE-1)];
+    __sync_synchronize();
+    rings[cpu].tail = t;
+  }
+  release(&readlock);
+  return k;
+}
+
+#else
+
+void
+traceinit(void)
+{
+}
+
+int
+traceread(struct schedevent *buf, int n)
+{
+  return -1;
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include "x86.h"
 #include "traps.h"
 #include "spinlock.h"
+#include "sched.h"
 
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
@@ -36,27 +37,42 @@ idtinit(void)
 void
 trap(struct trapframe *tf)
 {
+  int tick = 0, budget = 0;
+
+  // Until now the process was running in user mode.
+  if(myproc() && (tf->cs&3) == DPL_USER)
+    cputime(myproc(), 1);
+
   if(tf->trapno == T_SYSCALL){
     if(myproc()->killed)
       exit();
     myproc()->tf = tf;
     syscall();
+    // The call may have woken a process that should preempt us.
+    if(needresched())
+      yield();
     if(myproc()->killed)
       exit();
+    cputime(myproc(), 0);
     return;
   }
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
-    if(cpuid() == 0){
-      acquire(&tickslock);
-      ticks++;
-      wakeup(&ticks);
-      release(&tickslock);
-    }
+    tick = timerintr();
     if (myproc() && myproc()->state == RUNNING) {
-      myproc()->elapsed_time++;
-      //cprintf("Changed elapse time of proc %d to %d\n",myproc()->pid, myproc()->elapsed_time);
+      cputime(myproc(), 0);
+      if(tick){
+        myproc()->elapsed_time++;
+        deadlinetick();
+        cbstick();
+        mlfqtick();
+        gangtick();
+      }
+      // The budget is checked on its own timer, not only on ticks.
+      budget = SCHED_RT(myproc()->sched_policy) && overbudget(myproc());
+      if(!budget)
+        budgettimer(myproc());
     }
     lapiceoi();
     break;
@@ -75,6 +91,17 @@ trap(struct trapframe *tf)
     uartintr();
     lapiceoi();
     break;
+  case T_DEVICE:
+    // First FPU or SSE instruction in this time slice.
+    if((tf->cs&3) != DPL_USER)
+      panic("trap: FPU used in kernel");
+    fputrap();
+    break;
+  case T_WAKEUP:
+  case T_RESCHED:
+    // kick() set mycpu()->resched for T_RESCHED; checked below.
+    lapiceoi();
+    break;
   case T_IRQ0 + 7:
   case T_IRQ0 + IRQ_SPURIOUS:
     cprintf("cpu%d: spurious interrupt at %x:%x\n",
@@ -104,18 +131,29 @@ trap(struct trapframe *tf)
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
 
-  // Force process to give up CPU on clock tick.
+  // Force process to give up CPU on clock tick, or when a more
+  // urgent process was queued for this CPU.
   // If interrupts were on while locks held, would need to check nlock.
 
 
-  if(myproc() && myproc()->state == RUNNING &&
-     tf->trapno == T_IRQ0+IRQ_TIMER){
-      if((myproc()->sched_policy >= 0) &&
-              (myproc()->elapsed_time >= myproc()->exec_time))
+  if(myproc() && myproc()->state == RUNNING && (tick || budget || needresched())){
+      if(SCHED_RT(myproc()->sched_policy) && overbudget(myproc()))
       {
-          cprintf("The arrival time and pid value of the completed process is %d, %d\n", 
-          myproc()->arrival_time, myproc()->pid);
-          exit();
+          if(myproc()->periodic && (tf->cs&3) != DPL_USER){
+              // Finish the job on a tick taken in user space,
+              // not while a system call may hold locks.
+              yield();
+          } else {
+              jobcomplete(myproc());
+#ifndef SCHEDTRACE
+              cprintf("The arrival time and pid value of the completed process is %d, %d\n", 
+              myproc()->arrival_time, myproc()->pid);
+#endif
+              if(myproc()->periodic)
+                  jobdone();
+              else
+                  exit();
+          }
       } else{
           yield();
       }
@@ -124,4 +162,8 @@ trap(struct trapframe *tf)
   // Check if the process has been killed since we yielded
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
+
+  // Back to user mode.
+  if(myproc() && (tf->cs&3) == DPL_USER)
+    cputime(myproc(), 0);
 }
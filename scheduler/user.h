@@ -1,5 +1,9 @@
 struct stat;
 struct rtcdate;
+struct schedevent;
+struct schedstats;
+struct cpustat;
+struct sched_attr;
 
 // system calls
 int fork(void);
@@ -27,6 +31,17 @@ int sched_policy(int, int);
 int exec_time(int, int);
 int deadline(int, int);
 int rate(int, int);
+int schedtrace(struct schedevent*, int);
+int sched_stats(int, struct schedstats*);
+int sched_server(int, int);
+int cpustat(struct cpustat*, int);
+int tickets(int, int);
+int sched_setattr(int, struct sched_attr*);
+int sched_setattrs(int*, struct sched_attr*, int);
+int sched_setaffinity(int, uint);
+int sched_getaffinity(int);
+int sched_gang(int, int);
+int nsec(uint64*);
 
 // ulib.c
 int stat(const char*, struct stat*);
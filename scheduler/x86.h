@@ -130,6 +130,22 @@ xchg(volatile uint *addr, uint newval)
   return result;
 }
 
+// Enable interrupts and halt.  sti takes effect after the next
+// instruction, so no interrupt can slip in before the hlt.
+static inline void
+stihlt(void)
+{
+  asm volatile("sti; hlt");
+}
+
+static inline uint64
+rdtsc(void)
+{
+  uint64 val;
+  asm volatile("rdtsc" : "=A" (val));
+  return val;
+}
+
 static inline uint
 rcr2(void)
 {
@@ -144,6 +160,72 @@ lcr3(uint val)
   asm volatile("movl %0,%%cr3" : : "r" (val));
 }
 
+static inline uint
+rcr0(void)
+{
+  uint val;
+  asm volatile("movl %%cr0,%0" : "=r" (val));
+  return val;
+}
+
+static inline void
+lcr0(uint val)
+{
+  asm volatile("movl %0,%%cr0" : : "r" (val));
+}
+
+static inline uint
+rcr4(void)
+{
+  uint val;
+  asm volatile("movl %%cr4,%0" : "=r" (val));
+  return val;
+}
+
+static inline void
+lcr4(uint val)
+{
+  asm volatile("movl %0,%%cr4" : : "r" (val));
+}
+
+static inline void
+rdcpuid(uint leaf, uint *a, uint *b, uint *c, uint *d)
+{
+  asm volatile("cpuid" : "=a" (*a), "=b" (*b), "=c" (*c), "=d" (*d) : "a" (leaf));
+}
+
+// Clear CR0.TS, so FPU instructions no longer trap.
+static inline void
+clts(void)
+{
+  asm volatile("clts");
+}
+
+static inline void
+fninit(void)
+{
+  asm volatile("fninit");
+}
+
+static inline void
+ldmxcsr(uint val)
+{
+  asm volatile("ldmxcsr %0" : : "m" (val));
+}
+
+// Save or load the x87 and SSE state, 512 bytes 16-byte aligned.
+static inline void
+fxsave(void *p)
+{
+  asm volatile("fxsave (%0)" : : "r" (p) : "memory");
+}
+
+static inline void
+fxrstor(void *p)
+{
+  asm volatile("fxrstor (%0)" : : "r" (p) : "memory");
+}
+
 //PAGEBREAK: 36
 // Layout of the trap frame built on the stack by the
 // hardware and by trapasm.S, and passed to trap().